@@ -0,0 +1,318 @@
+#include "SyntheticScene.h"
+
+#include <mc_rtc/gui.h>
+
+#include <mc_rbdyn/RobotLoader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace mc_rtc::blender
+{
+
+namespace
+{
+
+/** Position of the element \p i of a kind on a 10x10 grid, the next 100 elements are stacked above */
+Eigen::Vector3d gridPosition(size_t i, double z0)
+{
+  return {0.5 + 0.2 * static_cast<double>(i % 10), -1.0 + 0.2 * static_cast<double>((i / 10) % 10),
+          z0 + 0.2 * static_cast<double>(i / 100)};
+}
+
+/** Point of a helix of radius \p r around \p center */
+Eigen::Vector3d helix(const Eigen::Vector3d & center, double r, double t)
+{
+  return center + Eigen::Vector3d{r * std::cos(t), r * std::sin(t), 0.05 * std::sin(0.1 * t)};
+}
+
+} // namespace
+
+const char * const SCENE_OPTIONS =
+    "  --robots N            number of robots (default 1)\n"
+    "  --robot-module NAME   robot module of the robots (default JVRC1)\n"
+    "  --markers M           number of Point3D, Transform, Arrow and Force elements, each (default 100)\n"
+    "  --trajectories K      number of streamed and full trajectories, each (default 10)\n"
+    "  --trajectory-points P maximum number of points of a full trajectory (default 1000)\n"
+    "  --polygons N          number of polygons (default 1)\n"
+    "  --polygon-points P    number of points of a polygon (default 1000)\n"
+    "  --moving F            fraction of the elements that move (default 1)\n"
+    "  --period N            the moving elements change every N frames (default 1)\n"
+    "  --KIND-moving F       --moving for one kind of elements: robots, markers, trajectories or polygons\n"
+    "  --KIND-period N       --period for one kind of elements\n";
+
+bool parse_scene_option(SyntheticSceneConfig & config, const std::string & option, const char * value)
+{
+  auto count = [&]() { return static_cast<unsigned int>(std::strtoul(value, nullptr, 10)); };
+  auto setPattern = [&](UpdatePattern & pattern, const std::string & field) {
+    if(field == "moving")
+    {
+      pattern.moving = std::strtod(value, nullptr);
+      return true;
+    }
+    if(field == "period")
+    {
+      pattern.period = std::max(count(), 1u);
+      return true;
+    }
+    return false;
+  };
+  const std::pair<const char *, UpdatePattern *> patterns[] = {{"robots", &config.robots_pattern},
+                                                               {"markers", &config.markers_pattern},
+                                                               {"trajectories", &config.trajectories_pattern},
+                                                               {"polygons", &config.polygons_pattern}};
+  if(option == "--moving" || option == "--period")
+  {
+    for(const auto & p : patterns)
+    {
+      setPattern(*p.second, option.substr(2));
+    }
+    return true;
+  }
+  for(const auto & p : patterns)
+  {
+    std::string prefix = std::string("--") + p.first + "-";
+    if(option.compare(0, prefix.size(), prefix) == 0)
+    {
+      return setPattern(*p.second, option.substr(prefix.size()));
+    }
+  }
+  if(option == "--robots")
+  {
+    config.robots = count();
+  }
+  else if(option == "--robot-module")
+  {
+    config.robot_module = value;
+  }
+  else if(option == "--markers")
+  {
+    config.markers = count();
+  }
+  else if(option == "--trajectories")
+  {
+    config.trajectories = count();
+  }
+  else if(option == "--trajectory-points")
+  {
+    config.trajectory_points = count();
+  }
+  else if(option == "--polygons")
+  {
+    config.polygons = count();
+  }
+  else if(option == "--polygon-points")
+  {
+    config.polygon_points = count();
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+SyntheticScene::SyntheticScene(mc_rtc::gui::StateBuilder & builder, const SyntheticSceneConfig & config)
+: builder_(builder), config_(config),
+  patterns_{&config_.robots_pattern, &config_.markers_pattern, &config_.trajectories_pattern,
+            &config_.polygons_pattern},
+  counts_{config_.robots, config_.markers, config_.trajectories, config_.polygons}
+{
+  for(auto * pattern : patterns_)
+  {
+    if(pattern->period == 0)
+    {
+      throw std::runtime_error("The update period of the synthetic scene must be at least 1");
+    }
+  }
+  add_robots();
+  add_markers();
+  add_trajectories();
+  add_polygons();
+}
+
+SyntheticScene::~SyntheticScene()
+{
+  builder_.removeCategory({"Synthetic"});
+}
+
+size_t SyntheticScene::elements() const noexcept
+{
+  return config_.robots + 4 * config_.markers + 2 * config_.trajectories + config_.polygons;
+}
+
+void SyntheticScene::step(double dt)
+{
+  t_ += dt;
+  frame_++;
+  for(size_t k = 0; k < KIND_COUNT; ++k)
+  {
+    if(frame_ % patterns_[k]->period == 0)
+    {
+      times_[k] = t_;
+    }
+  }
+  update_robots();
+  update_trajectories();
+  update_polygons();
+}
+
+bool SyntheticScene::moving(Kind kind, size_t i) const noexcept
+{
+  return static_cast<double>(i) < patterns_[kind]->moving * counts_[kind];
+}
+
+double SyntheticScene::time(Kind kind, size_t i) const noexcept
+{
+  return moving(kind, i) ? times_[kind] : 0;
+}
+
+void SyntheticScene::add_robots()
+{
+  if(config_.robots == 0)
+  {
+    return;
+  }
+  auto rm = mc_rbdyn::RobotLoader::get_robot_module(config_.robot_module);
+  if(!rm)
+  {
+    throw std::runtime_error("Cannot load the robot module " + config_.robot_module);
+  }
+  for(size_t i = 0; i < config_.robots; ++i)
+  {
+    auto robots = mc_rbdyn::loadRobot(*rm);
+    robots_.push_back(robots);
+    builder_.addElement({"Synthetic", "Robots"},
+                        mc_rtc::gui::Robot("robot_" + std::to_string(i),
+                                           [robots]() -> const mc_rbdyn::Robot & { return robots->robot(); }));
+  }
+  update_robots();
+}
+
+void SyntheticScene::add_markers()
+{
+  using namespace mc_rtc::gui;
+  for(size_t i = 0; i < config_.markers; ++i)
+  {
+    auto name = std::to_string(i);
+    auto position = [this, i](double z0) -> Eigen::Vector3d {
+      return gridPosition(i, z0) + Eigen::Vector3d{0, 0, 0.05 * std::sin(time(MARKERS, i) + 0.1 * i)};
+    };
+    builder_.addElement({"Synthetic", "Points"}, Point3D("Point " + name, PointConfig(Color::Red, 0.02),
+                                                         [position]() { return position(0.0); }));
+    builder_.addElement({"Synthetic", "Transforms"}, Transform("Transform " + name, [this, i, position]() {
+                          return sva::PTransformd(sva::RotZ(time(MARKERS, i)), position(1.0));
+                        }));
+    builder_.addElement({"Synthetic", "Arrows"},
+                        Arrow(
+                            "Arrow " + name, ArrowConfig(Color::Green), [position]() { return position(2.0); },
+                            [this, i, position]() {
+                              double t = time(MARKERS, i);
+                              return Eigen::Vector3d(position(2.0)
+                                                     + Eigen::Vector3d{0.1 * std::cos(t), 0.1 * std::sin(t), 0.1});
+                            }));
+    builder_.addElement({"Synthetic", "Forces"},
+                        Force(
+                            "Force " + name, ForceConfig(Color::Blue),
+                            [this, i]() {
+                              double t = time(MARKERS, i);
+                              return sva::ForceVecd(Eigen::Vector3d::Zero(),
+                                                    Eigen::Vector3d{10 * std::cos(t), 10 * std::sin(t), 100});
+                            },
+                            [position]() { return sva::PTransformd(position(3.0)); }));
+  }
+}
+
+void SyntheticScene::add_trajectories()
+{
+  using namespace mc_rtc::gui;
+  full_.resize(config_.trajectories);
+  for(size_t i = 0; i < config_.trajectories; ++i)
+  {
+    auto name = std::to_string(i);
+    Eigen::Vector3d center = gridPosition(i, 4.0);
+    builder_.addElement({"Synthetic", "Trajectories"},
+                        Trajectory("Streamed " + name, LineConfig(Color::Magenta),
+                                   [this, i, center]() { return helix(center, 0.08, time(TRAJECTORIES, i)); }));
+    if(!moving(TRAJECTORIES, i))
+    {
+      // A static full trajectory is complete from the start
+      for(size_t j = 0; j < config_.trajectory_points; ++j)
+      {
+        full_[i].push_back(helix(gridPosition(i, 4.1), 0.08, 1e-2 * static_cast<double>(j)));
+      }
+    }
+    builder_.addElement({"Synthetic", "Trajectories"},
+                        Trajectory("Full " + name, LineConfig(Color::Cyan), [this, i]() { return full_[i]; }));
+  }
+}
+
+void SyntheticScene::add_polygons()
+{
+  using namespace mc_rtc::gui;
+  polygons_.resize(config_.polygons);
+  for(size_t i = 0; i < config_.polygons; ++i)
+  {
+    builder_.addElement({"Synthetic", "Polygons"}, Polygon("Polygon " + std::to_string(i), LineConfig(Color::Yellow),
+                                                           [this, i]() { return polygons_[i]; }));
+  }
+  update_polygons();
+}
+
+void SyntheticScene::update_robots()
+{
+  for(size_t i = 0; i < robots_.size(); ++i)
+  {
+    double t = time(ROBOTS, i);
+    auto & robot = robots_[i]->robot();
+    auto & q = robot.mbc().q;
+    for(size_t j = 0; j < q.size(); ++j)
+    {
+      if(q[j].size() == 1)
+      {
+        q[j][0] = 0.2 * std::sin(t + 0.3 * static_cast<double>(j));
+      }
+    }
+    robot.posW(sva::PTransformd(sva::RotZ(0.2 * t), Eigen::Vector3d{-1.0 * static_cast<double>(i / 10),
+                                                                     1.5 * static_cast<double>(i % 10), 0.8}));
+  }
+}
+
+void SyntheticScene::update_trajectories()
+{
+  if(frame_ % patterns_[TRAJECTORIES]->period != 0 || config_.trajectory_points == 0)
+  {
+    return;
+  }
+  for(size_t i = 0; i < full_.size() && moving(TRAJECTORIES, i); ++i)
+  {
+    auto & points = full_[i];
+    if(points.size() >= config_.trajectory_points)
+    {
+      points.erase(points.begin());
+    }
+    points.push_back(helix(gridPosition(i, 4.1), 0.08, times_[TRAJECTORIES]));
+  }
+}
+
+void SyntheticScene::update_polygons()
+{
+  for(size_t i = 0; i < polygons_.size(); ++i)
+  {
+    double t = time(POLYGONS, i);
+    auto & polygon = polygons_[i];
+    polygon.resize(1);
+    polygon[0].resize(config_.polygon_points);
+    Eigen::Vector3d center{-1.0, -1.0 - 1.2 * static_cast<double>(i), 0.01};
+    for(size_t j = 0; j < config_.polygon_points; ++j)
+    {
+      double a = 2 * M_PI * static_cast<double>(j) / config_.polygon_points;
+      double r = 0.5 + 0.05 * std::sin(8 * a + t);
+      polygon[0][j] = center + Eigen::Vector3d{r * std::cos(a), r * std::sin(a), 0};
+    }
+  }
+}
+
+} // namespace mc_rtc::blender
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <mc_rtc/gui/StateBuilder.h>
+
+#include <mc_rbdyn/Robots.h>
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mc_rtc::blender
+{
+
+/** How the elements of one kind change over time */
+struct UpdatePattern
+{
+  /** Fraction of the elements that move, the others never change */
+  double moving = 1.0;
+  /** The moving elements change every this many frames */
+  unsigned int period = 1;
+};
+
+/** Parameters of a SyntheticScene */
+struct SyntheticSceneConfig
+{
+  /** Number of robots */
+  unsigned int robots = 1;
+  /** Robot module loaded for every robot */
+  std::string robot_module = "JVRC1";
+  /** Number of Point3D, Transform, Arrow and Force elements, this many of each kind */
+  unsigned int markers = 100;
+  /** Number of streamed trajectories and of growing full trajectories, this many of each kind */
+  unsigned int trajectories = 10;
+  /** Maximum number of points of a full trajectory, the oldest points are dropped after that */
+  unsigned int trajectory_points = 1000;
+  /** Number of polygons */
+  unsigned int polygons = 1;
+  /** Number of points of a polygon */
+  unsigned int polygon_points = 1000;
+  UpdatePattern robots_pattern;
+  UpdatePattern markers_pattern;
+  UpdatePattern trajectories_pattern;
+  UpdatePattern polygons_pattern;
+};
+
+/** Command line options of the scene handled by parse_scene_option(), one per line */
+extern const char * const SCENE_OPTIONS;
+
+/** Set \p option of \p config to \p value from the command line
+ *
+ * \returns False if \p option is not an option of the scene
+ */
+bool parse_scene_option(SyntheticSceneConfig & config, const std::string & option, const char * value);
+
+/** Adds a synthetic scene to a StateBuilder, used to load the client without a controller
+ *
+ * Every element is added in the Synthetic category. The elements only read the state of the scene, step() changes it.
+ */
+struct SyntheticScene
+{
+  /** Add the elements of the scene to \p builder, the robots are loaded here
+   *
+   * \throws std::runtime_error if the robot module cannot be loaded
+   */
+  SyntheticScene(mc_rtc::gui::StateBuilder & builder, const SyntheticSceneConfig & config);
+
+  /** Remove the elements of the scene from the builder */
+  ~SyntheticScene();
+
+  SyntheticScene(const SyntheticScene &) = delete;
+  SyntheticScene & operator=(const SyntheticScene &) = delete;
+
+  /** Advance the scene by \p dt seconds */
+  void step(double dt);
+
+  /** Number of elements in the scene */
+  size_t elements() const noexcept;
+
+private:
+  enum Kind
+  {
+    ROBOTS,
+    MARKERS,
+    TRAJECTORIES,
+    POLYGONS,
+    KIND_COUNT
+  };
+
+  mc_rtc::gui::StateBuilder & builder_;
+  SyntheticSceneConfig config_;
+  std::array<const UpdatePattern *, KIND_COUNT> patterns_;
+  std::array<unsigned int, KIND_COUNT> counts_;
+  /** Time of the last change of the moving elements of each kind */
+  std::array<double, KIND_COUNT> times_ = {};
+  double t_ = 0;
+  size_t frame_ = 0;
+  std::vector<std::shared_ptr<mc_rbdyn::Robots>> robots_;
+  std::vector<std::vector<Eigen::Vector3d>> full_;
+  std::vector<std::vector<std::vector<Eigen::Vector3d>>> polygons_;
+
+  /** True if the element \p i of \p kind moves */
+  bool moving(Kind kind, size_t i) const noexcept;
+
+  /** Time seen by the element \p i of \p kind, 0 if this element does not move */
+  double time(Kind kind, size_t i) const noexcept;
+
+  void add_robots();
+  void add_markers();
+  void add_trajectories();
+  void add_polygons();
+
+  void update_robots();
+  void update_trajectories();
+  void update_polygons();
+};
+
+} // namespace mc_rtc::blender
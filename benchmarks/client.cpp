@@ -0,0 +1,660 @@
+/** Drive the client with a synthetic scene or a recording, without Blender
+ *
+ * Usage: client_benchmark [options], run with --help for the list of options
+ *
+ * Every frame one GUI message is applied, then the 2D and 3D interfaces are drawn. The 3D interface only counts the
+ * calls it receives. The CPU time and the number of allocations of each frame are reported at the end, along with
+ * the time spent in every section of the Profiler.
+ *
+ * The measurements start after the warmup frames once every robot is loaded. Only the allocations of the main thread
+ * are counted, the robots are loaded and the meshes decoded in other threads.
+ */
+
+#include "BlenderClient.h"
+#include "Profiler.h"
+#include "Recording.h"
+#include "widgets/Robot.h"
+
+#include "SyntheticScene.h"
+
+#include <mc_rtc/gui/StateBuilder.h>
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> allocatedBytes{0};
+/** Set by the main thread, the allocations of the other threads are not counted */
+thread_local bool countAllocations = false;
+
+void count(size_t size)
+{
+  if(countAllocations)
+  {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  }
+}
+
+void * allocate(size_t size)
+{
+  count(size);
+  if(void * ptr = std::malloc(size ? size : 1))
+  {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void * allocate(size_t size, std::align_val_t alignment)
+{
+  count(size);
+  size_t align = static_cast<size_t>(alignment);
+  if(void * ptr = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align))
+  {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+} // namespace
+
+// Count every allocation made through operator new, the nothrow variants call these in the standard library
+
+void * operator new(size_t size)
+{
+  return allocate(size);
+}
+
+void * operator new[](size_t size)
+{
+  return allocate(size);
+}
+
+void * operator new(size_t size, std::align_val_t alignment)
+{
+  return allocate(size, alignment);
+}
+
+void * operator new[](size_t size, std::align_val_t alignment)
+{
+  return allocate(size, alignment);
+}
+
+void operator delete(void * ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void * ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void * ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void * ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void * ptr, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void * ptr, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void * ptr, size_t, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void * ptr, size_t, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+
+namespace
+{
+
+using namespace mc_rtc::blender;
+
+/** An Interface3D that only counts the calls it receives and the values they carry */
+struct CountingInterface : public Interface3D
+{
+  enum Call
+  {
+    ADD_COLLECTION,
+    HIDE_COLLECTION,
+    REMOVE_COLLECTION,
+    LOAD_MESH,
+    SET_MESH_POSITION,
+    SET_MESH_POSITIONS,
+    REMOVE_MESH,
+    ADD_INTERACTIVE_MARKER,
+    UPDATE_INTERACTIVE_MARKER,
+    SET_MARKER_HIDDEN,
+    REMOVE_INTERACTIVE_MARKER,
+    ADD_ARROW,
+    UPDATE_ARROW,
+    REMOVE_ARROW,
+    ADD_POLYLINE,
+    SET_POLYLINE_STYLE,
+    SET_POLYLINE,
+    APPEND_POLYLINE,
+    SET_POLYLINE_MARKERS,
+    SET_POLYLINE_FRAMES,
+    REMOVE_POLYLINE,
+    CALL_COUNT
+  };
+
+  static constexpr std::array<const char *, CALL_COUNT> NAMES = {"add_collection",
+                                                                 "hide_collection",
+                                                                 "remove_collection",
+                                                                 "load_mesh",
+                                                                 "set_mesh_position",
+                                                                 "set_mesh_positions",
+                                                                 "remove_mesh",
+                                                                 "add_interactive_marker",
+                                                                 "update_interactive_marker",
+                                                                 "set_marker_hidden",
+                                                                 "remove_interactive_marker",
+                                                                 "add_arrow",
+                                                                 "update_arrow",
+                                                                 "remove_arrow",
+                                                                 "add_polyline",
+                                                                 "set_polyline_style",
+                                                                 "set_polyline",
+                                                                 "append_polyline",
+                                                                 "set_polyline_markers",
+                                                                 "set_polyline_frames",
+                                                                 "remove_polyline"};
+
+  /** Number of calls of each kind */
+  std::array<uint64_t, CALL_COUNT> calls = {};
+  /** Number of floats passed by the calls of each kind */
+  std::array<uint64_t, CALL_COUNT> values = {};
+
+  void add_collection(Handle, const std::vector<std::string> &, const std::string &) override
+  {
+    calls[ADD_COLLECTION]++;
+  }
+
+  void hide_collection(Handle, bool) override
+  {
+    calls[HIDE_COLLECTION]++;
+  }
+
+  void remove_collection(Handle) override
+  {
+    calls[REMOVE_COLLECTION]++;
+  }
+
+  void load_mesh(Handle,
+                 Handle,
+                 const std::string &,
+                 const std::string &,
+                 const std::array<double, 4> &,
+                 const std::shared_ptr<const MeshData> &) override
+  {
+    calls[LOAD_MESH]++;
+  }
+
+  void set_mesh_position(Handle, const sva::PTransformd &) override
+  {
+    calls[SET_MESH_POSITION]++;
+  }
+
+  void set_mesh_positions(const std::vector<Handle> &, const std::vector<float> & poses) override
+  {
+    calls[SET_MESH_POSITIONS]++;
+    values[SET_MESH_POSITIONS] += poses.size();
+  }
+
+  void remove_mesh(Handle) override
+  {
+    calls[REMOVE_MESH]++;
+  }
+
+  void add_interactive_marker(Handle,
+                              const std::vector<std::string> &,
+                              const std::string &,
+                              const ControlAxis &,
+                              const std::function<void(const sva::PTransformd &)> &) override
+  {
+    calls[ADD_INTERACTIVE_MARKER]++;
+  }
+
+  void update_interactive_marker(Handle, bool, const sva::PTransformd &) override
+  {
+    calls[UPDATE_INTERACTIVE_MARKER]++;
+  }
+
+  void set_marker_hidden(Handle, bool) override
+  {
+    calls[SET_MARKER_HIDDEN]++;
+  }
+
+  void remove_interactive_marker(Handle) override
+  {
+    calls[REMOVE_INTERACTIVE_MARKER]++;
+  }
+
+  void add_arrow(Handle, const std::vector<std::string> &, const std::string &) override
+  {
+    calls[ADD_ARROW]++;
+  }
+
+  void update_arrow(Handle,
+                    const Eigen::Vector3d &,
+                    const Eigen::Vector3d &,
+                    double,
+                    double,
+                    double,
+                    const std::array<double, 4> &) override
+  {
+    calls[UPDATE_ARROW]++;
+  }
+
+  void remove_arrow(Handle) override
+  {
+    calls[REMOVE_ARROW]++;
+  }
+
+  void add_polyline(Handle, const std::vector<std::string> &, const std::string &) override
+  {
+    calls[ADD_POLYLINE]++;
+  }
+
+  void set_polyline_style(Handle, const std::array<double, 4> &, double) override
+  {
+    calls[SET_POLYLINE_STYLE]++;
+  }
+
+  void set_polyline(Handle, const std::vector<float> & points) override
+  {
+    calls[SET_POLYLINE]++;
+    values[SET_POLYLINE] += points.size();
+  }
+
+  void append_polyline(Handle, const std::vector<float> & points) override
+  {
+    calls[APPEND_POLYLINE]++;
+    values[APPEND_POLYLINE] += points.size();
+  }
+
+  void set_polyline_markers(Handle, const Eigen::Vector3d &, const Eigen::Vector3d &, double) override
+  {
+    calls[SET_POLYLINE_MARKERS]++;
+  }
+
+  void set_polyline_frames(Handle, const std::vector<float> & poses) override
+  {
+    calls[SET_POLYLINE_FRAMES]++;
+    values[SET_POLYLINE_FRAMES] += poses.size();
+  }
+
+  void remove_polyline(Handle) override
+  {
+    calls[REMOVE_POLYLINE]++;
+  }
+};
+
+struct Options
+{
+  SyntheticSceneConfig scene;
+  /** Recording replayed instead of the synthetic scene */
+  std::string recording;
+  /** Number of measured frames */
+  size_t frames = 1000;
+  /** Frames applied before the measurements start */
+  size_t warmup = 100;
+  /** Maximum time (s) spent waiting for the robots after the warmup */
+  double load_timeout = 60;
+  /** Frame rate (Hz) of the synthetic scene */
+  double rate = 200;
+  /** If true, the frames are paced at rate instead of running as fast as possible */
+  bool realtime = false;
+};
+
+void usage(const char * exe)
+{
+  std::printf("Usage: %s [options]\n"
+              "%s"
+              "  --recording PATH      replay a recording instead of the synthetic scene\n"
+              "  --frames N            number of measured frames (default 1000)\n"
+              "  --warmup N            frames applied before the measurements (default 100)\n"
+              "  --load-timeout S      maximum wait for the robots after the warmup (default 60)\n"
+              "  --rate HZ             frame rate of the synthetic scene (default 200)\n"
+              "  --realtime            pace the frames at the frame rate\n",
+              exe, SCENE_OPTIONS);
+}
+
+bool parse(int argc, char * argv[], Options & options)
+{
+  for(int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if(arg == "--help")
+    {
+      return false;
+    }
+    if(arg == "--realtime")
+    {
+      options.realtime = true;
+      continue;
+    }
+    if(i + 1 == argc)
+    {
+      std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+      return false;
+    }
+    const char * value = argv[++i];
+    if(parse_scene_option(options.scene, arg, value))
+    {
+      continue;
+    }
+    auto count = [&]() { return static_cast<unsigned int>(std::strtoul(value, nullptr, 10)); };
+    if(arg == "--recording")
+    {
+      options.recording = value;
+    }
+    else if(arg == "--frames")
+    {
+      options.frames = std::max(count(), 1u);
+    }
+    else if(arg == "--warmup")
+    {
+      options.warmup = count();
+    }
+    else if(arg == "--load-timeout")
+    {
+      options.load_timeout = std::max(std::strtod(value, nullptr), 0.0);
+    }
+    else if(arg == "--rate")
+    {
+      options.rate = std::max(std::strtod(value, nullptr), 1.0);
+    }
+    else
+    {
+      std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+/** Provides the GUI messages of the benchmark */
+struct MessageGenerator
+{
+  virtual ~MessageGenerator() = default;
+  /** Returns the next message */
+  virtual std::pair<const char *, size_t> next() = 0;
+};
+
+struct SceneGenerator : public MessageGenerator
+{
+  SceneGenerator(const Options & options) : scene_(builder_, options.scene), dt_(1.0 / options.rate) {}
+
+  std::pair<const char *, size_t> next() override
+  {
+    scene_.step(dt_);
+    size_t size = builder_.update(buffer_);
+    return {buffer_.data(), size};
+  }
+
+  inline size_t elements() const noexcept
+  {
+    return scene_.elements();
+  }
+
+private:
+  mc_rtc::gui::StateBuilder builder_;
+  SyntheticScene scene_;
+  double dt_;
+  std::vector<char> buffer_;
+};
+
+struct RecordingGenerator : public MessageGenerator
+{
+  RecordingGenerator(const std::string & path) : recording_(path)
+  {
+    if(recording_.size() == 0)
+    {
+      throw std::runtime_error(path + " holds no message");
+    }
+  }
+
+  std::pair<const char *, size_t> next() override
+  {
+    const auto & msg = recording_[next_];
+    next_ = (next_ + 1) % recording_.size();
+    return {msg.data, msg.size};
+  }
+
+private:
+  Recording recording_;
+  size_t next_ = 0;
+};
+
+/** Measurements of one frame */
+struct Frame
+{
+  double generateMs;
+  double applyMs;
+  double draw2DMs;
+  double draw3DMs;
+  uint64_t allocations;
+  uint64_t allocatedBytes;
+  size_t messageSize;
+};
+
+void report(const char * name, std::vector<double> values, const char * unit)
+{
+  std::sort(values.begin(), values.end());
+  double sum = 0;
+  for(auto v : values)
+  {
+    sum += v;
+  }
+  auto at = [&](double q) { return values[std::min(values.size() - 1, static_cast<size_t>(q * values.size()))]; };
+  std::printf("%-18s mean %10.3f  p50 %10.3f  p99 %10.3f  max %10.3f %s\n", name, sum / values.size(), at(0.5),
+              at(0.99), values.back(), unit);
+}
+
+template<typename T>
+std::vector<double> column(const std::vector<Frame> & frames, T Frame::*member)
+{
+  std::vector<double> out;
+  out.reserve(frames.size());
+  for(const auto & f : frames)
+  {
+    out.push_back(static_cast<double>(f.*member));
+  }
+  return out;
+}
+
+} // namespace
+
+int main(int argc, char * argv[])
+{
+  Options options;
+  if(!parse(argc, argv, options))
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::unique_ptr<MessageGenerator> generator;
+  try
+  {
+    if(options.recording.size())
+    {
+      generator = std::make_unique<RecordingGenerator>(options.recording);
+      std::printf("Replaying %s\n", options.recording.c_str());
+    }
+    else
+    {
+      auto scene = std::make_unique<SceneGenerator>(options);
+      std::printf("Synthetic scene with %zu elements\n", scene->elements());
+      generator = std::move(scene);
+    }
+  }
+  catch(const std::exception & exc)
+  {
+    std::fprintf(stderr, "%s\n", exc.what());
+    return 1;
+  }
+
+  ImGui::CreateContext();
+  auto & io = ImGui::GetIO();
+  io.DisplaySize = ImVec2(1920, 1080);
+  unsigned char * pixels = nullptr;
+  int width = 0;
+  int height = 0;
+  io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+  CountingInterface gui;
+  BlenderClient client(gui);
+  auto & profiler = Profiler::get();
+
+  countAllocations = true;
+  using clock = std::chrono::steady_clock;
+  auto ms = [](clock::duration dt) { return std::chrono::duration<double, std::milli>(dt).count(); };
+  auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / options.rate));
+  auto nextFrame = clock::now();
+  auto runFrame = [&]() {
+    if(options.realtime)
+    {
+      std::this_thread::sleep_until(nextFrame);
+      nextFrame += period;
+    }
+    Frame frame;
+    auto t0 = clock::now();
+    auto message = generator->next();
+    auto t1 = clock::now();
+    uint64_t allocations0 = allocations.load(std::memory_order_relaxed);
+    uint64_t bytes0 = allocatedBytes.load(std::memory_order_relaxed);
+    client.handle_message(message.first, message.second);
+    auto t2 = clock::now();
+    ImGui::NewFrame();
+    client.draw2D(io.DisplaySize);
+    ImGui::Render();
+    auto t3 = clock::now();
+    client.draw3D();
+    auto t4 = clock::now();
+    frame.generateMs = ms(t1 - t0);
+    frame.applyMs = ms(t2 - t1);
+    frame.draw2DMs = ms(t3 - t2);
+    frame.draw3DMs = ms(t4 - t3);
+    frame.allocations = allocations.load(std::memory_order_relaxed) - allocations0;
+    frame.allocatedBytes = allocatedBytes.load(std::memory_order_relaxed) - bytes0;
+    frame.messageSize = message.second;
+    profiler.end_frame();
+    return frame;
+  };
+
+  for(size_t i = 0; i < options.warmup; ++i)
+  {
+    runFrame();
+  }
+  // The robots are loaded in the background, measuring before they are displayed would miss their cost
+  auto robotsLoaded = [&]() {
+    const auto & robots = client.robots();
+    return std::all_of(robots.begin(), robots.end(), [](const auto & r) { return r.second->mesh_poses() != nullptr; });
+  };
+  auto loadStart = clock::now();
+  size_t loadFrames = 0;
+  while(!robotsLoaded())
+  {
+    if(std::chrono::duration<double>(clock::now() - loadStart).count() > options.load_timeout)
+    {
+      std::fprintf(stderr, "The robots were not loaded after %.0fs\n", options.load_timeout);
+      return 1;
+    }
+    runFrame();
+    loadFrames++;
+  }
+  if(loadFrames)
+  {
+    std::printf("Robots loaded after %zu extra frames (%.3fs)\n", loadFrames,
+                std::chrono::duration<double>(clock::now() - loadStart).count());
+  }
+
+  gui.calls = {};
+  gui.values = {};
+  profiler.reset();
+  std::vector<Frame> frames;
+  frames.reserve(options.frames);
+  for(size_t i = 0; i < options.frames; ++i)
+  {
+    frames.push_back(runFrame());
+  }
+
+  std::printf("\n%zu frames (after %zu warmup frames)\n\n", frames.size(), options.warmup);
+  report("message size", column(frames, &Frame::messageSize), "bytes");
+  report("generate", column(frames, &Frame::generateMs), "ms");
+  report("apply", column(frames, &Frame::applyMs), "ms");
+  report("draw2D", column(frames, &Frame::draw2DMs), "ms");
+  report("draw3D", column(frames, &Frame::draw3DMs), "ms");
+  std::vector<double> total;
+  for(const auto & f : frames)
+  {
+    total.push_back(f.applyMs + f.draw2DMs + f.draw3DMs);
+  }
+  report("client total", total, "ms");
+  report("allocations", column(frames, &Frame::allocations), "");
+  report("allocated", column(frames, &Frame::allocatedBytes), "bytes");
+
+  std::printf("\nProfiler sections (ms per frame over the last %zu frames)\n", profiler.frames());
+  for(size_t s = 0; s < profiler.sections().size(); ++s)
+  {
+    auto samples = profiler.samples(s);
+    if(samples.empty())
+    {
+      continue;
+    }
+    report(profiler.sections()[s].c_str(), std::vector<double>(samples.begin(), samples.end()), "ms");
+  }
+
+  std::printf("\nInterface3D calls per frame\n");
+  for(size_t c = 0; c < CountingInterface::CALL_COUNT; ++c)
+  {
+    if(gui.calls[c] == 0)
+    {
+      continue;
+    }
+    std::printf("%-26s %12.2f calls %14.1f values\n", CountingInterface::NAMES[c],
+                static_cast<double>(gui.calls[c]) / frames.size(), static_cast<double>(gui.values[c]) / frames.size());
+  }
+  const auto & stats = client.stats();
+  std::printf("\nApplied updates %lu, skipped updates %lu, sent mesh updates %lu, skipped mesh updates %lu\n",
+              static_cast<unsigned long>(stats.applied_updates), static_cast<unsigned long>(stats.skipped_updates),
+              static_cast<unsigned long>(stats.sent_mesh_updates),
+              static_cast<unsigned long>(stats.skipped_mesh_updates));
+
+  ImGui::DestroyContext();
+  return 0;
+}
@@ -0,0 +1,162 @@
+/** Publish a synthetic scene like a controller would, used to load the client in Blender
+ *
+ * Usage: gui_publisher [options], run with --help for the list of options
+ *
+ * The scene is published on the default addresses of mc_rtc so the client connects to it as to any controller.
+ */
+
+#include "SyntheticScene.h"
+
+#include <mc_control/ControllerServer.h>
+
+#include <mc_rtc/gui/StateBuilder.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+using namespace mc_rtc::blender;
+
+std::atomic<bool> running{true};
+
+struct Options
+{
+  SyntheticSceneConfig scene;
+  /** Publication rate (Hz) */
+  double rate = 200;
+  /** Publication duration (s), 0 publishes until interrupted */
+  double duration = 0;
+  std::string pub_uri = "ipc:///tmp/mc_rtc_pub.ipc";
+  std::string pull_uri = "ipc:///tmp/mc_rtc_pull.ipc";
+};
+
+void usage(const char * exe)
+{
+  std::printf("Usage: %s [options]\n"
+              "%s"
+              "  --rate HZ             publication rate (default 200)\n"
+              "  --duration S          stop after S seconds, 0 publishes until interrupted (default 0)\n"
+              "  --pub URI             publication address (default ipc:///tmp/mc_rtc_pub.ipc)\n"
+              "  --pull URI            requests address (default ipc:///tmp/mc_rtc_pull.ipc)\n",
+              exe, SCENE_OPTIONS);
+}
+
+bool parse(int argc, char * argv[], Options & options)
+{
+  for(int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if(arg == "--help")
+    {
+      return false;
+    }
+    if(i + 1 == argc)
+    {
+      std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+      return false;
+    }
+    const char * value = argv[++i];
+    if(parse_scene_option(options.scene, arg, value))
+    {
+      continue;
+    }
+    if(arg == "--rate")
+    {
+      options.rate = std::max(std::strtod(value, nullptr), 1.0);
+    }
+    else if(arg == "--duration")
+    {
+      options.duration = std::max(std::strtod(value, nullptr), 0.0);
+    }
+    else if(arg == "--pub")
+    {
+      options.pub_uri = value;
+    }
+    else if(arg == "--pull")
+    {
+      options.pull_uri = value;
+    }
+    else
+    {
+      std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char * argv[])
+{
+  Options options;
+  if(!parse(argc, argv, options))
+  {
+    usage(argv[0]);
+    return 1;
+  }
+  std::signal(SIGINT, [](int) { running = false; });
+  std::signal(SIGTERM, [](int) { running = false; });
+
+  double dt = 1.0 / options.rate;
+  mc_control::ControllerServer server(dt, dt, {options.pub_uri}, {options.pull_uri});
+  mc_rtc::gui::StateBuilder builder;
+  std::unique_ptr<SyntheticScene> scene;
+  try
+  {
+    scene = std::make_unique<SyntheticScene>(builder, options.scene);
+  }
+  catch(const std::exception & exc)
+  {
+    std::fprintf(stderr, "%s\n", exc.what());
+    return 1;
+  }
+  std::printf("Publishing %zu elements at %.0f Hz on %s\n", scene->elements(), options.rate, options.pub_uri.c_str());
+
+  using clock = std::chrono::steady_clock;
+  auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(dt));
+  auto start = clock::now();
+  auto nextFrame = start;
+  auto nextReport = start + std::chrono::seconds(1);
+  size_t published = 0;
+  double busyMs = 0;
+  double maxMs = 0;
+  while(running)
+  {
+    auto frameStart = clock::now();
+    if(options.duration > 0 && std::chrono::duration<double>(frameStart - start).count() >= options.duration)
+    {
+      break;
+    }
+    scene->step(dt);
+    server.handle_requests(builder);
+    server.publish(builder);
+    published++;
+    double ms = std::chrono::duration<double, std::milli>(clock::now() - frameStart).count();
+    busyMs += ms;
+    maxMs = std::max(maxMs, ms);
+    if(clock::now() >= nextReport)
+    {
+      // A rate below the requested one means the publisher itself is the bottleneck
+      std::printf("%zu messages/s, %.3f ms per message (max %.3f ms)\n", published, busyMs / published, maxMs);
+      std::fflush(stdout);
+      published = 0;
+      busyMs = 0;
+      maxMs = 0;
+      nextReport += std::chrono::seconds(1);
+    }
+    // When the publication is late, the next frames are not sent in a burst to catch up
+    nextFrame = std::max(nextFrame + period, clock::now());
+    std::this_thread::sleep_until(nextFrame);
+  }
+  return 0;
+}
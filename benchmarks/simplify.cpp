@@ -0,0 +1,83 @@
+/** Time the simplification of 100k-point trajectories at several tolerances
+ *
+ * Usage: simplify_benchmark [points] [runs]
+ */
+
+#include "widgets/details/Simplify.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using mc_rtc::blender::details::Simplifier;
+
+namespace
+{
+
+/** A noisy helix, similar to a swing foot trajectory repeated many times */
+std::vector<float> helix(size_t count)
+{
+  std::mt19937 rng(42);
+  std::normal_distribution<float> noise(0.0f, 1e-4f);
+  std::vector<float> out(3 * count);
+  for(size_t i = 0; i < count; ++i)
+  {
+    float t = 1e-3f * static_cast<float>(i);
+    out[3 * i] = 0.5f * std::cos(t) + noise(rng);
+    out[3 * i + 1] = 0.5f * std::sin(t) + noise(rng);
+    out[3 * i + 2] = 0.05f * t + noise(rng);
+  }
+  return out;
+}
+
+/** A random walk, a worst case for the simplification */
+std::vector<float> walk(size_t count)
+{
+  std::mt19937 rng(42);
+  std::normal_distribution<float> step(0.0f, 1e-3f);
+  std::vector<float> out(3 * count);
+  for(size_t i = 1; i < count; ++i)
+  {
+    for(size_t j = 0; j < 3; ++j)
+    {
+      out[3 * i + j] = out[3 * (i - 1) + j] + step(rng);
+    }
+  }
+  return out;
+}
+
+void run(const char * name, const std::vector<float> & points, size_t runs)
+{
+  size_t count = points.size() / 3;
+  Simplifier simplifier;
+  for(float tolerance : {1e-4f, 1e-3f, 1e-2f, 1e-1f})
+  {
+    std::vector<double> times;
+    size_t kept = 0;
+    for(size_t i = 0; i < runs; ++i)
+    {
+      auto start = std::chrono::steady_clock::now();
+      kept = simplifier.simplify(points.data(), count, tolerance).size();
+      std::chrono::duration<double, std::milli> dt = std::chrono::steady_clock::now() - start;
+      times.push_back(dt.count());
+    }
+    std::sort(times.begin(), times.end());
+    std::printf("%-6s %zu points, tolerance %6.0e: %7zu kept, median %8.3f ms, min %8.3f ms\n", name, count, tolerance,
+                kept, times[times.size() / 2], times[0]);
+  }
+}
+
+} // namespace
+
+int main(int argc, char * argv[])
+{
+  size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+  size_t runs = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20;
+  run("helix", helix(count), std::max<size_t>(runs, 1));
+  run("walk", walk(count), std::max<size_t>(runs, 1));
+  return 0;
+}
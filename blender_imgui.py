@@ -2,17 +2,21 @@ import bpy
 from bpy.types import SpaceView3D
 import bgl as gl
 import gpu
-from gpu_extras.batch import batch_for_shader
 
 import numpy as np
-import ctypes as C
 
 from . import mc_rtc_blender as imgui
 #import imgui
 
+def config_dir():
+    """Folder where the add-on keeps its caches"""
+    return bpy.utils.user_resource('CONFIG', path = 'mc_rtc_blender', create = True)
+
 class BlenderImguiRenderer(object):
     """Integration of ImGui into Blender."""
 
+    FONT_SIZE = 15.0
+
     VERTEX_SHADER_SRC = """
     uniform mat4 ProjMtx;
     in vec2 Position;
@@ -36,7 +40,8 @@ class BlenderImguiRenderer(object):
     out vec4 Out_Color;
 
     void main() {
-        Out_Color = Frag_Color * texture(Texture, Frag_UV.st);
+        // The font atlas only holds the alpha channel
+        Out_Color = Frag_Color * vec4(1.0, 1.0, 1.0, texture(Texture, Frag_UV.st).r);
     }
     """
 
@@ -55,12 +60,25 @@ class BlenderImguiRenderer(object):
         self._elements_handle = None
         self._vao_handle = None
 
+        # Re-used from one frame to the next
+        self._frame = imgui.DrawDataExport()
+        # Batches of the last uploaded frame
+        self._draw_calls = None
+
         if not imgui.get_current_context():
             raise RuntimeError("No valid ImGui context. Use imgui.create_context() first")
         self.io = imgui.get_io()
         self._font_texture = None
+        self._font_scale = None
         self.io.delta_time = 1.0 / 60.0
         self._create_device_objects()
+
+    def set_font_scale(self, scale):
+        """Rasterize the font for the given UI scale, this is a no-op if the scale did not change"""
+        if scale == self._font_scale:
+            return
+        imgui.build_font_atlas(self.io.fonts, self.FONT_SIZE, scale, config_dir())
+        self._font_scale = scale
         self.refresh_font_texture()
 
     def refresh_font_texture(self):
@@ -69,7 +87,7 @@ class BlenderImguiRenderer(object):
         gl.glGetIntegerv(gl.GL_TEXTURE_BINDING_2D, buf)
         last_texture = buf[0]
 
-        width, height, pixels = self.io.fonts.get_tex_data_as_rgba32()
+        width, height, pixels = self.io.fonts.get_tex_data_as_alpha8()
 
         if self._font_texture is not None:
             gl.glDeleteTextures([self._font_texture])
@@ -81,9 +99,9 @@ class BlenderImguiRenderer(object):
         gl.glTexParameteri(gl.GL_TEXTURE_2D, gl.GL_TEXTURE_MIN_FILTER, gl.GL_LINEAR)
         gl.glTexParameteri(gl.GL_TEXTURE_2D, gl.GL_TEXTURE_MAG_FILTER, gl.GL_LINEAR)
 
-        pixel_buffer = gl.Buffer(gl.GL_BYTE, [4 * width * height])
-        pixel_buffer[:] = pixels
-        gl.glTexImage2D(gl.GL_TEXTURE_2D, 0, gl.GL_RGBA, width, height, 0, gl.GL_RGBA, gl.GL_UNSIGNED_BYTE, pixel_buffer)
+        pixel_buffer = gl.Buffer(gl.GL_BYTE, [width * height])
+        pixel_buffer[:] = pixels.ravel()
+        gl.glTexImage2D(gl.GL_TEXTURE_2D, 0, gl.GL_R8, width, height, 0, gl.GL_RED, gl.GL_UNSIGNED_BYTE, pixel_buffer)
 
         self.io.fonts.texture_id = self._font_texture
         gl.glBindTexture(gl.GL_TEXTURE_2D, last_texture)
@@ -91,6 +109,10 @@ class BlenderImguiRenderer(object):
 
     def _create_device_objects(self):
         self._bl_shader = gpu.types.GPUShader(self.VERTEX_SHADER_SRC, self.FRAGMENT_SHADER_SRC)
+        self._vertex_format = gpu.types.GPUVertFormat()
+        self._vertex_format.attr_add(id = "Position", comp_type = 'F32', len = 2, fetch_mode = 'FLOAT')
+        self._vertex_format.attr_add(id = "UV", comp_type = 'F32', len = 2, fetch_mode = 'FLOAT')
+        self._vertex_format.attr_add(id = "Color", comp_type = 'F32', len = 4, fetch_mode = 'FLOAT')
 
     def render(self, draw_data):
         io = self.io
@@ -159,41 +181,16 @@ class BlenderImguiRenderer(object):
         shader.uniform_float("ProjMtx", ortho_projection)
         shader.uniform_int("Texture", 0)
 
-        for commands in draw_data.commands_lists:
-            size = commands.idx_buffer_size * imgui.INDEX_SIZE // 4
-            address = commands.idx_buffer_data
-            ptr = C.cast(address, C.POINTER(C.c_int))
-            idx_buffer_np = np.ctypeslib.as_array(ptr, shape=(size,))
-
-            size = commands.vtx_buffer_size * imgui.VERTEX_SIZE // 4
-            address = commands.vtx_buffer_data
-            ptr = C.cast(address, C.POINTER(C.c_float))
-            vtx_buffer_np = np.ctypeslib.as_array(ptr, shape=(size,))
-            vtx_buffer_shaped = vtx_buffer_np.reshape(-1, imgui.VERTEX_SIZE // 4)
-
-            idx_buffer_offset = 0
-            for command in commands.commands:
-                x, y, z, w = command.clip_rect
+        # Identical frames re-use the batches uploaded for the previous one
+        if imgui.draw_data_changed() or self._draw_calls is None:
+            with imgui.profiler().section("imgui/upload"):
+                self._draw_calls = self._create_draw_calls(draw_data)
+        with imgui.profiler().section("imgui/draw"):
+            for batch, texture, (x, y, z, w) in self._draw_calls:
                 gl.glScissor(int(x), int(fb_height - w), int(z - x), int(w - y))
-
-                vertices = vtx_buffer_shaped[:,:2]
-                uvs = vtx_buffer_shaped[:,2:4]
-                colors = vtx_buffer_shaped.view(np.uint8)[:,4*4:]
-                colors = colors.astype('f') / 255.0
-
-                indices = idx_buffer_np[idx_buffer_offset:idx_buffer_offset+command.elem_count]
-
-                gl.glBindTexture(gl.GL_TEXTURE_2D, command.texture_id)
-
-                batch = batch_for_shader(shader, 'TRIS', {
-                    "Position": vertices,
-                    "UV": uvs,
-                    "Color": colors,
-                }, indices=indices)
+                gl.glBindTexture(gl.GL_TEXTURE_2D, texture)
                 batch.draw(shader)
 
-                idx_buffer_offset += command.elem_count
-
         # restore modified GL state
         gl.glUseProgram(last_program)
         gl.glActiveTexture(last_active_texture)
@@ -228,6 +225,37 @@ class BlenderImguiRenderer(object):
         gl.glScissor(last_scissor_box[0], last_scissor_box[1], last_scissor_box[2], last_scissor_box[3])
 
 
+    def _create_draw_calls(self, draw_data):
+        """Upload the draw data, returns a list of (batch, texture, clip_rect)"""
+        # Convert the whole frame at once, the renderer only slices the resulting arrays
+        frame = self._frame
+        draw_data.export(frame)
+        positions = frame.positions
+        uvs = frame.uvs
+        colors = frame.colors
+        indices = frame.indices
+        lists = frame.lists.tolist()
+        commands = frame.commands.tolist()
+        textures = frame.textures.tolist()
+        clip_rects = frame.clip_rects.tolist()
+
+        # One vertex buffer per draw list shared by all its commands
+        vertex_buffers = []
+        for vtx_offset, vtx_count in lists:
+            vertices = slice(vtx_offset, vtx_offset + vtx_count)
+            vbo = gpu.types.GPUVertBuf(self._vertex_format, vtx_count)
+            vbo.attr_fill("Position", positions[vertices])
+            vbo.attr_fill("UV", uvs[vertices])
+            vbo.attr_fill("Color", colors[vertices])
+            vertex_buffers.append(vbo)
+
+        draw_calls = []
+        for (list_idx, idx_offset, count), texture, clip_rect in zip(commands, textures, clip_rects):
+            ibo = gpu.types.GPUIndexBuf(type = 'TRIS', seq = indices[idx_offset:idx_offset + count])
+            batch = gpu.types.GPUBatch(type = 'TRIS', buf = vertex_buffers[list_idx], elem = ibo)
+            draw_calls.append((batch, texture, clip_rect))
+        return draw_calls
+
     def _invalidate_device_objects(self):
         if self._font_texture > -1:
             gl.glDeleteTextures([self._font_texture])
@@ -309,7 +337,7 @@ class GlobalImgui:
         region = context.region
         io = imgui.get_io()
         io.display_size = region.width, region.height
-        io.font_global_scale = context.preferences.system.ui_scale * context.preferences.view.ui_scale
+        self.imgui_backend.set_font_scale(context.preferences.system.ui_scale * context.preferences.view.ui_scale)
         imgui.new_frame()
 
         for cb, SpaceType in self.callbacks.values():
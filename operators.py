@@ -29,22 +29,25 @@ from bpy.types import Operator
 
 import mathutils
 
-from .blender_imgui import ImguiBasedOperator, imgui
+from .blender_imgui import ImguiBasedOperator, config_dir, imgui
 from .interactive_markers import InteractiveMarkers
 
 from math import cos, sin, pi
 
-import hashlib
+import numpy as np
 import os.path
+import time
 
 # -------------------------------------------------------------------
 
-def file_hash(filename):
-    sha256 = hashlib.sha256()
-    with open(filename, "rb") as f:
-        for block in iter(lambda: f.read(4096), b""):
-            sha256.update(block)
-    return sha256.hexdigest()
+_mesh_registry = None
+
+def mesh_registry():
+    """Registry of the mesh files content shared by every client, its index is kept in Blender's configuration folder"""
+    global _mesh_registry
+    if _mesh_registry is None:
+        _mesh_registry = imgui.MeshRegistry(os.path.join(config_dir(), 'meshes.index'))
+    return _mesh_registry
 
 def new_object_name(name):
     if not name in bpy.data.objects:
@@ -165,6 +168,101 @@ class Arrow(object):
             self._head.hide_set(True)
         self._material.diffuse_color = color
 
+class Polyline(object):
+    """A POLY curve, the start/end markers and the frames drawn along it are created on demand"""
+    # Above this number of new points, the whole curve is rewritten in bulk
+    BULK_APPEND = 64
+
+    def __init__(self, collection):
+        self._collection = collection
+        name = new_object_name("polyline")
+        self._curve = bpy.data.curves.new(name, 'CURVE')
+        self._curve.dimensions = '3D'
+        self._curve.bevel_resolution = 0
+        self._material = bpy.data.materials.new(name = "{}_material".format(name))
+        self._curve.materials.append(self._material)
+        self._object = bpy.data.objects.new(name, self._curve)
+        self._collection.objects.link(self._object)
+        self._size = 0
+        self._start = None
+        self._end = None
+        self._frames = []
+        self.set(np.zeros((0, 3), dtype = np.float32))
+    def __del__(self):
+        for obj in [self._object, self._start, self._end] + self._frames:
+            if obj is not None:
+                bpy.data.objects.remove(obj)
+        bpy.data.curves.remove(self._curve)
+        bpy.data.collections.remove(self._collection)
+    def style(self, color, width):
+        self._material.diffuse_color = color
+        self._curve.bevel_depth = width / 2
+    def _write(self, spline, points):
+        # Curve points have a 4th (weight) coordinate
+        co = np.ones((points.shape[0], 4), dtype = np.float32)
+        co[:, 0:3] = points
+        spline.points.foreach_set('co', co.ravel())
+    def set(self, points):
+        self._curve.splines.clear()
+        spline = self._curve.splines.new('POLY')
+        # A new spline already has one point
+        if points.shape[0] > 1:
+            spline.points.add(points.shape[0] - 1)
+        if points.shape[0]:
+            self._write(spline, points)
+        self._size = points.shape[0]
+        self._object.hide_set(self._size < 2)
+    def append(self, points):
+        if self._size == 0 or points.shape[0] > Polyline.BULK_APPEND:
+            if self._size:
+                spline = self._curve.splines[0]
+                co = np.empty(4 * self._size, dtype = np.float32)
+                spline.points.foreach_get('co', co)
+                points = np.concatenate((co.reshape((-1, 4))[:, 0:3], points))
+            self.set(points)
+            return
+        spline = self._curve.splines[0]
+        spline.points.add(points.shape[0])
+        for i, p in enumerate(points.tolist()):
+            spline.points[self._size + i].co = p + [1.0]
+        self._size += points.shape[0]
+        self._object.hide_set(self._size < 2)
+    def _marker(self, add):
+        add()
+        obj = bpy.context.selected_objects[0]
+        obj.name = new_object_name("{}_marker".format(self._object.name))
+        obj.data.materials.append(self._material)
+        bpy.ops.collection.objects_remove_all()
+        self._collection.objects.link(obj)
+        obj.select_set(False)
+        return obj
+    def markers(self, start, end, size):
+        if size == 0:
+            for obj in [self._start, self._end]:
+                if obj is not None:
+                    obj.hide_set(True)
+            return
+        if self._start is None:
+            self._start = self._marker(lambda: bpy.ops.mesh.primitive_cube_add(size = 1))
+            self._end = self._marker(lambda: bpy.ops.mesh.primitive_uv_sphere_add(radius = 1))
+        for obj, pos in [(self._start, start), (self._end, end)]:
+            obj.hide_set(False)
+            obj.location = pos
+            obj.scale = [size] * 3
+    def frames(self, poses):
+        while len(self._frames) < poses.shape[0]:
+            frame = bpy.data.objects.new("{}_frame".format(self._object.name), None)
+            frame.empty_display_type = 'ARROWS'
+            frame.empty_display_size = 0.1
+            frame.rotation_mode = 'QUATERNION'
+            self._collection.objects.link(frame)
+            self._frames.append(frame)
+        while len(self._frames) > poses.shape[0]:
+            bpy.data.objects.remove(self._frames.pop())
+        for frame, pose in zip(self._frames, poses.tolist()):
+            frame.location = pose[0:3]
+            frame.rotation_quaternion = pose[3:7]
+
 class BlenderInterface(imgui.Interface3D):
     def __init__(self):
         super().__init__()
@@ -174,8 +272,8 @@ class BlenderInterface(imgui.Interface3D):
         bpy.context.scene.collection.children.link(self._collection)
         self._meshes = {}
         self._meshes_hash = {}
-        self._markers = {}
-        self._arrows = {}
+        # Objects created through the interface indexed by their handle
+        self._objects = []
         # Set some saner default for visualization
         bpy.context.space_data.shading.color_type = 'TEXTURE'
         if 'Cube' in bpy.data.objects:
@@ -185,8 +283,15 @@ class BlenderInterface(imgui.Interface3D):
         super().__del__()
         bpy.data.collections.remove(self._collection)
 
-    def _get_collection(self, name):
-        return self._collection.children[name]
+    def _set_object(self, handle, obj):
+        if handle >= len(self._objects):
+            self._objects.extend([None] * (handle + 1 - len(self._objects)))
+        self._objects[handle] = obj
+
+    def _pop_object(self, handle):
+        obj = self._objects[handle]
+        self._objects[handle] = None
+        return obj
 
     def _fix_material(self, mesh, color):
         if len(mesh.material_slots) == 0:
@@ -197,35 +302,80 @@ class BlenderInterface(imgui.Interface3D):
             mesh.material_slots[0].material = mat
         else:
             for mat in [m.material for m in mesh.material_slots]:
+                if mat is None or mat.node_tree is None:
+                    continue
                 for node in mat.node_tree.nodes:
                     for i in node.inputs:
                         if i.name == "Alpha" and i.default_value == 0.0:
                             i.default_value = 1.0
 
-    def add_collection(self, category, name):
+    def _new_collection(self, category, name):
         ncol = bpy.data.collections.new('/'.join(category + [name]))
         self._collection.children.link(ncol)
-        return ncol.name
+        return ncol
+
+    def add_collection(self, collection, category, name):
+        self._set_object(collection, self._new_collection(category, name))
 
-    def hide_collection(self, name, hide):
-        self._get_collection(name).hide_viewport = hide
+    def hide_collection(self, collection, hide):
+        self._objects[collection].hide_viewport = hide
 
-    def remove_collection(self, name):
-        bpy.data.collections.remove(self._get_collection(name))
+    def remove_collection(self, collection):
+        bpy.data.collections.remove(self._pop_object(collection))
 
     def _copy_mesh(self, collection, meshPath, meshName):
         mesh = self._meshes[meshPath].copy()
-        self._get_collection(collection).objects.link(mesh)
+        collection.objects.link(mesh)
         mesh.name = new_object_name(meshName)
-        return mesh.name
+        mesh.rotation_mode = 'QUATERNION'
+        return mesh
 
-    def load_mesh(self, collection, meshPath, meshName, defaultColor):
+    def _load_mesh(self, collection, meshPath, meshName, defaultColor, data):
         if not os.path.exists(meshPath):
-            return ""
-        mesh_hash = file_hash(meshPath)
+            return None
+        mesh_hash = mesh_registry().hash(meshPath)
         if meshPath in self._meshes and mesh_hash == self._meshes_hash[meshPath]:
             return self._copy_mesh(collection, meshPath, meshName)
         self._meshes_hash[meshPath] = mesh_hash
+        if data is None:
+            try:
+                data = imgui.load_mesh_data(meshPath)
+            except RuntimeError as e:
+                print(e)
+        # Textures are not handled by the native loader
+        if data is not None and not data.textured:
+            mesh = self._mesh_from_data(data, meshName)
+        else:
+            mesh = self._import_mesh(meshPath)
+        if mesh is None:
+            return None
+        collection.objects.link(mesh)
+        mesh.name = new_object_name(meshName)
+        mesh.rotation_mode = 'QUATERNION'
+        self._fix_material(mesh, defaultColor)
+        self._meshes[meshPath] = mesh
+        return mesh
+
+    def _mesh_from_data(self, data, meshName):
+        nTriangles = len(data.triangles)
+        me = bpy.data.meshes.new(meshName)
+        me.vertices.add(len(data.vertices))
+        me.vertices.foreach_set("co", data.vertices.ravel())
+        me.loops.add(3 * nTriangles)
+        me.loops.foreach_set("vertex_index", data.triangles.ravel())
+        me.polygons.add(nTriangles)
+        me.polygons.foreach_set("loop_start", np.arange(0, 3 * nTriangles, 3, dtype = np.int32))
+        me.polygons.foreach_set("loop_total", np.full(nTriangles, 3, dtype = np.int32))
+        me.polygons.foreach_set("material_index", data.triangle_materials)
+        for name, color in zip(data.material_names, data.material_colors.tolist()):
+            mat = bpy.data.materials.new(name = name)
+            mat.diffuse_color = color
+            me.materials.append(mat)
+        me.update(calc_edges = True)
+        me.validate()
+        return bpy.data.objects.new(meshName, me)
+
+    def _import_mesh(self, meshPath):
         ext = os.path.splitext(meshPath)[1]
         if ext.lower() == '.dae':
             bpy.ops.wm.collada_import(filepath = meshPath, import_units = True)
@@ -233,25 +383,25 @@ class BlenderInterface(imgui.Interface3D):
             bpy.ops.import_mesh.stl(filepath = meshPath, use_scene_unit = True)
         else:
             print("Requested loading of {} that I cannot handle (yet)".format(meshPath))
-            return ""
+            return None
         [ bpy.data.objects.remove(o) for o in bpy.context.selected_objects if o.type != 'MESH' ]
         if len(bpy.context.selected_objects) == 0:
-            return ""
+            return None
         bpy.context.view_layer.objects.active = bpy.context.selected_objects[0]
         bpy.ops.object.join()
         bpy.ops.object.transform_apply()
         mesh = bpy.context.selected_objects[0]
         bpy.ops.collection.objects_remove_all()
-        self._get_collection(collection).objects.link(mesh)
-        mesh.name = new_object_name(meshName)
-        self._fix_material(mesh, defaultColor)
-        self._meshes[meshPath] = mesh
-        return mesh.name
+        return mesh
 
-    def set_mesh_position(self, meshName, pose):
-        if meshName == "":
+    def load_mesh(self, mesh, collection, meshPath, meshName, defaultColor, data):
+        # data holds the geometry if it was already decoded, None otherwise
+        self._set_object(mesh, self._load_mesh(self._objects[collection], meshPath, meshName, defaultColor, data))
+
+    def set_mesh_position(self, mesh, pose):
+        obj = self._objects[mesh]
+        if obj is None:
             return
-        obj = bpy.data.objects[meshName]
         t = pose.translation
         obj.location = t
         r = pose.rotation.inverse()
@@ -261,48 +411,65 @@ class BlenderInterface(imgui.Interface3D):
         obj.rotation_quaternion[2] = r.y()
         obj.rotation_quaternion[3] = r.z()
 
-    def remove_mesh(self, meshName):
-        if meshName == "":
-            return
-        pass
+    def set_mesh_positions(self, meshes, poses):
+        # poses is a (len(meshes), 7) array of [tx, ty, tz, qw, qx, qy, qz]
+        objects = self._objects
+        for mesh, pose in zip(meshes.tolist(), poses.tolist()):
+            obj = objects[mesh]
+            if obj is None:
+                continue
+            obj.location = pose[0:3]
+            obj.rotation_quaternion = pose[3:7]
 
-    def add_interactive_marker(self, category, name, axis, callback):
-        collection = self.add_collection(category, name)
-        marker = InteractiveMarker(self._get_collection(collection), name, axis, callback)
-        self._markers[marker.name()] = marker
-        return marker.name()
+    def remove_mesh(self, mesh):
+        self._pop_object(mesh)
 
-    def update_interactive_marker(self, name, ro, pos):
-        if name not in self._markers:
-            return
-        self._markers[name].update(ro, pos)
+    def add_interactive_marker(self, marker, category, name, axis, callback):
+        collection = self._new_collection(category, name)
+        self._set_object(marker, InteractiveMarker(collection, name, axis, callback))
 
-    def set_marker_hidden(self, name, hidden):
-        if name not in self._markers:
-            return
-        self._markers[name].hidden(hidden)
+    def update_interactive_marker(self, marker, ro, pos):
+        self._objects[marker].update(ro, pos)
 
-    def remove_interactive_marker(self, name):
-        if name not in self._markers:
-            return
-        self._markers[name].remove()
-        del self._markers[name]
+    def set_marker_hidden(self, marker, hidden):
+        self._objects[marker].hidden(hidden)
 
-    def add_arrow(self, category, name):
-        collection = self.add_collection(category, name)
-        arrow = Arrow(self._get_collection(collection))
-        self._arrows[arrow.name()] = arrow
-        return arrow.name()
+    def remove_interactive_marker(self, marker):
+        self._pop_object(marker).remove()
 
-    def update_arrow(self, name, start, end, shaft_diam, head_diam, head_len, color):
-        if name not in self._arrows:
-            return
-        self._arrows[name].update(start, end, shaft_diam, head_diam, head_len, color)
+    def add_arrow(self, arrow, category, name):
+        collection = self._new_collection(category, name)
+        self._set_object(arrow, Arrow(collection))
 
-    def remove_arrow(self, name):
-        if name not in self._arrows:
-            return
-        del self._arrows[name]
+    def update_arrow(self, arrow, start, end, shaft_diam, head_diam, head_len, color):
+        self._objects[arrow].update(start, end, shaft_diam, head_diam, head_len, color)
+
+    def remove_arrow(self, arrow):
+        self._pop_object(arrow)
+
+    def add_polyline(self, polyline, category, name):
+        collection = self._new_collection(category, name)
+        self._set_object(polyline, Polyline(collection))
+
+    def set_polyline_style(self, polyline, color, width):
+        self._objects[polyline].style(color, width)
+
+    def set_polyline(self, polyline, points):
+        # points is a (N, 3) array
+        self._objects[polyline].set(points)
+
+    def append_polyline(self, polyline, points):
+        self._objects[polyline].append(points)
+
+    def set_polyline_markers(self, polyline, start, end, size):
+        self._objects[polyline].markers(start, end, size)
+
+    def set_polyline_frames(self, polyline, poses):
+        # poses is a (N, 7) array of [tx, ty, tz, qw, qx, qy, qz]
+        self._objects[polyline].frames(poses)
+
+    def remove_polyline(self, polyline):
+        self._pop_object(polyline)
 
 
 class McRtcGUI(Operator,ImguiBasedOperator):
@@ -310,6 +477,12 @@ class McRtcGUI(Operator,ImguiBasedOperator):
     bl_idname = "object.mc_rtc_gui"
     bl_label = "mc_rtc GUI"
 
+    replay: bpy.props.StringProperty(name = "Replay", subtype = 'FILE_PATH',
+                                     description = "Recording replayed instead of the controller messages")
+    replay_speed: bpy.props.FloatProperty(name = "Replay speed", default = 1.0, min = 0.0,
+                                          description = "0 replays as fast as possible")
+    replay_loop: bpy.props.BoolProperty(name = "Loop replay", default = False)
+
     def __init__(self):
         super().__init__()
         self._timer = None
@@ -321,12 +494,15 @@ class McRtcGUI(Operator,ImguiBasedOperator):
         super().__del__()
 
     def draw(self, context):
+        self._client.camera = list(context.region_data.view_matrix.inverted().translation)
         self._client.draw2D(imgui.ImVec2(context.region.width, context.region.height))
         self._client.draw3D()
 
     def invoke(self, context, event):
         # Call init_imgui() at the beginning
         self.init_imgui(context)
+        if self.replay:
+            self._client.replay(bpy.path.abspath(self.replay), self.replay_speed, self.replay_loop)
         context.window_manager.modal_handler_add(self)
         self._timer = context.window_manager.event_timer_add(1.0 / 60.0, window = context.window)
         return {'RUNNING_MODAL'}
@@ -335,6 +511,7 @@ class McRtcGUI(Operator,ImguiBasedOperator):
         if self._timer:
             wm = context.window_manager
             wm.event_timer_remove(self._timer)
+        mesh_registry().save()
 
     def modal(self, context, event):
         # We need to do this because of https://developer.blender.org/T77419
@@ -348,7 +525,38 @@ class McRtcGUI(Operator,ImguiBasedOperator):
             return {'PASS_THROUGH'}
         area.tag_redraw()
 
-        self._client.update()
+        # Ctrl+Shift+P toggles the performance window
+        if event.type == 'P' and event.value == 'PRESS' and event.ctrl and event.shift:
+            settings = self._client.settings
+            settings.show_performance = not settings.show_performance
+            return {'RUNNING_MODAL'}
+
+        # Ctrl+Shift+T starts a trace, the next press writes it to the configuration folder
+        if event.type == 'T' and event.value == 'PRESS' and event.ctrl and event.shift:
+            tracer = imgui.tracer()
+            if tracer.enabled:
+                tracer.stop()
+                path = os.path.join(config_dir(), time.strftime('trace-%Y%m%d-%H%M%S.json'))
+                if tracer.dump(path):
+                    print("mc_rtc trace with {} events written to {}".format(tracer.events, path))
+            else:
+                tracer.start()
+            return {'RUNNING_MODAL'}
+
+        # Ctrl+Shift+R starts recording the GUI messages to the configuration folder, the next press stops it
+        if event.type == 'R' and event.value == 'PRESS' and event.ctrl and event.shift:
+            if self._client.recording:
+                print("{} GUI messages recorded".format(self._client.stats.recorded_messages))
+                self._client.record('')
+            else:
+                self._client.record(os.path.join(config_dir(), time.strftime('recording-%Y%m%d-%H%M%S.mcrtc-gui')))
+            return {'RUNNING_MODAL'}
+
+        # The client is updated on the timer only, other events (mouse moves, keys) only redraw
+        if event.type == 'TIMER':
+            # A profiler frame covers one client update and the redraws that follow it
+            imgui.profiler().end_frame()
+            self._client.update()
         InteractiveMarkers.update()
 
         # Handle the event as you wish here, as in any modal operator
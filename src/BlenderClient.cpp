@@ -1,5 +1,7 @@
 #include "BlenderClient.h"
 
+#include "Profiler.h"
+
 #include "widgets/Arrow.h"
 #include "widgets/Force.h"
 #include "widgets/Point3D.h"
@@ -9,52 +11,271 @@
 #include "widgets/Trajectory.h"
 #include "widgets/Transform.h"
 #include "widgets/XYTheta.h"
+#include "widgets/details/Fingerprint.h"
+
+#include <mc_rtc/logging.h>
 
 namespace mc_rtc::blender
 {
 
+void BlenderClient::update()
+{
+  MC_RTC_BLENDER_PROFILE("client/update");
+  if(recorder_ && recorder_->failed())
+  {
+    // The source already stopped writing to it
+    record("");
+  }
+  bool background = settings_.background_receive || recorder_;
+  if(!replay_ && background != static_cast<bool>(source_))
+  {
+    reset_source();
+    if(background)
+    {
+      try
+      {
+        auto source = std::make_unique<SubscriberSource>(sub_socket_);
+        subscriber_ = source.get();
+        source_ = std::move(source);
+        source_->record(recorder_);
+        lastState_ = std::chrono::steady_clock::now();
+      }
+      catch(const std::exception & exc)
+      {
+        mc_rtc::log::error("{}, messages are received on the main thread", exc.what());
+        settings_.background_receive = false;
+        record("");
+      }
+    }
+  }
+  stats_.recorded_messages = recorder_ ? recorder_->messages() : 0;
+  if(!source_)
+  {
+    mc_rtc::imgui::Client::update();
+    return;
+  }
+  // Checked before poll() so the last state of the replay is applied before going back to the controller
+  bool replayFinished = replay_ && replay_->finished();
+  mc_rtc::Configuration state;
+  double decodeMs = 0;
+  bool received = source_->poll(state, decodeMs);
+  stats_.received_messages = source_->received();
+  stats_.dropped_messages = source_->dropped();
+  auto now = std::chrono::steady_clock::now();
+  if(!received)
+  {
+    if(replayFinished)
+    {
+      mc_rtc::log::info("Replay finished, receiving from the controller again");
+      reset_source();
+      return;
+    }
+    // Same behavior as the mc_rtc client: an empty state clears the widgets of a controller that stopped publishing
+    if(timeout() > 0 && now - lastState_ > std::chrono::duration<double>(timeout()))
+    {
+      lastState_ = now;
+      handle_gui_state(mc_rtc::Configuration{});
+    }
+    return;
+  }
+  lastState_ = now;
+  static const size_t decodeSection = Profiler::get().section("client/decode");
+  Profiler::get().add(decodeSection, decodeMs);
+  MC_RTC_BLENDER_PROFILE("client/apply");
+  handle_gui_state(state);
+}
+
+void BlenderClient::connect_controller(const std::string & sub_uri, const std::string & push_uri)
+{
+  // The mc_rtc client closes its SUB socket and nanomsg may give the same id to the new one, the source must not
+  // outlive the socket it borrowed. It is created again for the new socket by the next update()
+  if(subscriber_)
+  {
+    reset_source();
+  }
+  connect(sub_uri, push_uri);
+}
+
+void BlenderClient::reset_source()
+{
+  source_.reset();
+  subscriber_ = nullptr;
+  replay_ = nullptr;
+}
+
+bool BlenderClient::record(const std::string & path)
+{
+  std::shared_ptr<Recorder> recorder;
+  if(path.size())
+  {
+    try
+    {
+      recorder = std::make_shared<Recorder>(path);
+    }
+    catch(const std::exception & exc)
+    {
+      mc_rtc::log::error(exc.what());
+      return false;
+    }
+    mc_rtc::log::info("Recording the GUI messages to {}", path);
+  }
+  recorder_ = recorder;
+  if(source_)
+  {
+    source_->record(recorder_);
+  }
+  return true;
+}
+
+bool BlenderClient::replay(const std::string & path, double speed, bool loop)
+{
+  if(replay_)
+  {
+    reset_source();
+  }
+  if(path.empty())
+  {
+    return true;
+  }
+  std::shared_ptr<const Recording> recording;
+  try
+  {
+    recording = std::make_shared<const Recording>(path);
+  }
+  catch(const std::exception & exc)
+  {
+    mc_rtc::log::error(exc.what());
+    return false;
+  }
+  mc_rtc::log::info("Replaying {} ({} messages, {:.1f}s)", path, recording->size(), recording->duration() * 1e-9);
+  auto source = std::make_unique<ReplaySource>(std::move(recording), speed, loop);
+  reset_source();
+  replay_ = source.get();
+  source_ = std::move(source);
+  lastState_ = std::chrono::steady_clock::now();
+  source_->record(recorder_);
+  return true;
+}
+
+void BlenderClient::handle_message(const char * data, size_t size)
+{
+  mc_rtc::Configuration state;
+  {
+    MC_RTC_BLENDER_PROFILE("client/decode");
+    state = mc_rtc::Configuration::fromMessagePack(data, size);
+  }
+  MC_RTC_BLENDER_PROFILE("client/apply");
+  handle_gui_state(state);
+}
+
+void BlenderClient::draw2D(ImVec2 windowSize)
+{
+  {
+    MC_RTC_BLENDER_PROFILE("client/draw2D");
+    mc_rtc::imgui::Client::draw2D(windowSize);
+  }
+  if(settings_.show_performance)
+  {
+    Profiler::get().draw_window(&settings_.show_performance);
+  }
+}
+
+void BlenderClient::draw3D()
+{
+  MC_RTC_BLENDER_PROFILE("client/draw3D");
+  mc_rtc::imgui::Client::draw3D();
+}
+
+bool BlenderClient::apply(Widget & widget, uint64_t fingerprint, bool interactive)
+{
+  // The fingerprint is always updated so that an element that stops being interactive is not skipped right away
+  if(widget.changed(fingerprint) || interactive || !settings_.skip_unchanged)
+  {
+    stats_.applied_updates++;
+    return true;
+  }
+  stats_.skipped_updates++;
+  return false;
+}
+
 void BlenderClient::point3d(const ElementId & id,
                             const ElementId & requestId,
                             bool ro,
                             const Eigen::Vector3d & pos,
                             const mc_rtc::gui::PointConfig & config)
 {
-  widget<Point3D>(id, gui_, requestId).data(ro, pos, config);
+  MC_RTC_BLENDER_PROFILE("data/point3d");
+  auto & w = widget<Point3D>(id, gui_, requestId);
+  if(apply(w, details::fingerprint(ro, pos, config), !ro))
+  {
+    ProfilerScope profile(w.data_section("point3d"));
+    w.data(ro, pos, config);
+  }
 }
 
 void BlenderClient::trajectory(const ElementId & id,
                                const std::vector<Eigen::Vector3d> & points,
                                const mc_rtc::gui::LineConfig & config)
 {
-  widget<Trajectory<Eigen::Vector3d>>(id, gui_).data(points, config);
+  MC_RTC_BLENDER_PROFILE("data/trajectory");
+  auto & w = widget<Trajectory<Eigen::Vector3d>>(id, gui_);
+  if(apply(w, details::fingerprint(points, config), false))
+  {
+    ProfilerScope profile(w.data_section("trajectory"));
+    w.data(points, config);
+  }
 }
 
 void BlenderClient::trajectory(const ElementId & id,
                                const std::vector<sva::PTransformd> & points,
                                const mc_rtc::gui::LineConfig & config)
 {
-  widget<Trajectory<sva::PTransformd>>(id, gui_).data(points, config);
+  MC_RTC_BLENDER_PROFILE("data/trajectory");
+  auto & w = widget<Trajectory<sva::PTransformd>>(id, gui_);
+  if(apply(w, details::fingerprint(points, config), false))
+  {
+    ProfilerScope profile(w.data_section("trajectory"));
+    w.data(points, config);
+  }
 }
 
 void BlenderClient::trajectory(const ElementId & id,
                                const Eigen::Vector3d & point,
                                const mc_rtc::gui::LineConfig & config)
 {
-  widget<Trajectory<Eigen::Vector3d>>(id, gui_).data(point, config);
+  MC_RTC_BLENDER_PROFILE("data/trajectory");
+  auto & w = widget<Trajectory<Eigen::Vector3d>>(id, gui_);
+  if(apply(w, details::fingerprint(point, config), false))
+  {
+    ProfilerScope profile(w.data_section("trajectory"));
+    w.data(point, config);
+  }
 }
 
 void BlenderClient::trajectory(const ElementId & id,
                                const sva::PTransformd & point,
                                const mc_rtc::gui::LineConfig & config)
 {
-  widget<Trajectory<sva::PTransformd>>(id, gui_).data(point, config);
+  MC_RTC_BLENDER_PROFILE("data/trajectory");
+  auto & w = widget<Trajectory<sva::PTransformd>>(id, gui_);
+  if(apply(w, details::fingerprint(point, config), false))
+  {
+    ProfilerScope profile(w.data_section("trajectory"));
+    w.data(point, config);
+  }
 }
 
 void BlenderClient::polygon(const ElementId & id,
                             const std::vector<std::vector<Eigen::Vector3d>> & points,
                             const mc_rtc::gui::LineConfig & config)
 {
-  widget<Polygon>(id, gui_).data(points, config);
+  MC_RTC_BLENDER_PROFILE("data/polygon");
+  auto & w = widget<Polygon>(id, gui_);
+  if(apply(w, details::fingerprint(points, config), false))
+  {
+    ProfilerScope profile(w.data_section("polygon"));
+    w.data(points, config);
+  }
 }
 
 void BlenderClient::force(const ElementId & id,
@@ -64,7 +285,13 @@ void BlenderClient::force(const ElementId & id,
                           const mc_rtc::gui::ForceConfig & forceConfig,
                           bool /* ro */)
 {
-  widget<Force>(id, gui_, requestId).data(force, pos, forceConfig);
+  MC_RTC_BLENDER_PROFILE("data/force");
+  auto & w = widget<Force>(id, gui_, requestId);
+  if(apply(w, details::fingerprint(force, pos, forceConfig), false))
+  {
+    ProfilerScope profile(w.data_section("force"));
+    w.data(force, pos, forceConfig);
+  }
 }
 
 void BlenderClient::arrow(const ElementId & id,
@@ -74,17 +301,35 @@ void BlenderClient::arrow(const ElementId & id,
                           const mc_rtc::gui::ArrowConfig & config,
                           bool ro)
 {
-  widget<Arrow>(id, gui_, requestId).data(start, end, config, ro);
+  MC_RTC_BLENDER_PROFILE("data/arrow");
+  auto & w = widget<Arrow>(id, gui_, requestId);
+  if(apply(w, details::fingerprint(start, end, config, ro), !ro))
+  {
+    ProfilerScope profile(w.data_section("arrow"));
+    w.data(start, end, config, ro);
+  }
 }
 
 void BlenderClient::rotation(const ElementId & id, const ElementId & requestId, bool ro, const sva::PTransformd & pos)
 {
-  widget<Rotation>(id, gui_, requestId).data(ro, pos);
+  MC_RTC_BLENDER_PROFILE("data/rotation");
+  auto & w = widget<Rotation>(id, gui_, requestId);
+  if(apply(w, details::fingerprint(ro, pos), !ro))
+  {
+    ProfilerScope profile(w.data_section("rotation"));
+    w.data(ro, pos);
+  }
 }
 
 void BlenderClient::transform(const ElementId & id, const ElementId & requestId, bool ro, const sva::PTransformd & pos)
 {
-  widget<TransformWidget>(id, gui_, requestId).data(ro, pos);
+  MC_RTC_BLENDER_PROFILE("data/transform");
+  auto & w = widget<TransformWidget>(id, gui_, requestId);
+  if(apply(w, details::fingerprint(ro, pos), !ro))
+  {
+    ProfilerScope profile(w.data_section("transform"));
+    w.data(ro, pos);
+  }
 }
 
 void BlenderClient::xytheta(const ElementId & id,
@@ -93,7 +338,13 @@ void BlenderClient::xytheta(const ElementId & id,
                             const Eigen::Vector3d & xytheta,
                             double altitude)
 {
-  widget<XYTheta>(id, gui_, requestId).data(ro, xytheta, altitude);
+  MC_RTC_BLENDER_PROFILE("data/xytheta");
+  auto & w = widget<XYTheta>(id, gui_, requestId);
+  if(apply(w, details::fingerprint(ro, xytheta, altitude), !ro))
+  {
+    ProfilerScope profile(w.data_section("xytheta"));
+    w.data(ro, xytheta, altitude);
+  }
 }
 
 void BlenderClient::robot(const ElementId & id,
@@ -101,7 +352,13 @@ void BlenderClient::robot(const ElementId & id,
                           const std::vector<std::vector<double>> & q,
                           const sva::PTransformd & posW)
 {
-  widget<Robot>(id, gui_).data(params, q, posW);
+  MC_RTC_BLENDER_PROFILE("data/robot");
+  auto & w = widget<Robot>(id, gui_);
+  if(apply(w, details::fingerprint(params, q, posW), false))
+  {
+    ProfilerScope profile(w.data_section("robot"));
+    w.data(params, q, posW);
+  }
 }
 
 } // namespace mc_rtc::blender
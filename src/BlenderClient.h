@@ -1,8 +1,13 @@
 #pragma once
 
+#include <chrono>
+#include <map>
+#include <memory>
+
 #include "mc_rtc-imgui/Client.h"
 
 #include "Interface3D.h"
+#include "MessageSource.h"
 
 namespace mc_rtc::blender
 {
@@ -10,12 +15,169 @@ namespace mc_rtc::blender
 using Client = mc_rtc::imgui::Client;
 using ElementId = mc_rtc::imgui::ElementId;
 
+struct Robot;
+struct Widget;
+
+/** Settings shared by the widgets of a BlenderClient */
+struct ClientSettings
+{
+  /** A body whose translation changed less than this (in meters) is not updated */
+  double translation_tolerance = 1e-5;
+  /** A body whose orientation changed less than this (in radians) is not updated */
+  double rotation_tolerance = 1e-4;
+  /** Maximum number of meshes created per frame by a robot being loaded */
+  unsigned int meshes_per_frame = 16;
+  /** Maximum number of points kept by a streamed trajectory, the older points are decimated to make room */
+  unsigned int trajectory_max_points = 10000;
+  /** Points of a streamed trajectory older than this (in seconds) are dropped, 0 keeps them */
+  double trajectory_max_duration = 0;
+  /** A streamed point closer than this (in meters) to the previous point is skipped */
+  double trajectory_min_distance = 1e-3;
+  /** A streamed point rotated less than this (in radians) from the previous point is skipped */
+  double trajectory_min_angle = 1e-2;
+  /** Full trajectories with at least this many points are simplified */
+  unsigned int trajectory_lod_min_points = 1000;
+  /** Simplification tolerance of long trajectories (in meters) per meter of distance to the camera, 0 disables it */
+  double trajectory_lod_tolerance = 1e-3;
+  /** Skip the widget updates that are identical to the previous one, interactive elements are always updated */
+  bool skip_unchanged = true;
+  /** Receive and decode the GUI messages in a background thread, update() then only applies the latest state */
+  bool background_receive = false;
+  /** Show the Performance window of the Profiler */
+  bool show_performance = false;
+};
+
+/** Statistics collected by the widgets of a BlenderClient */
+struct ClientStats
+{
+  /** Number of mesh pose updates skipped because the mesh did not move */
+  uint64_t skipped_mesh_updates = 0;
+  /** Number of mesh pose updates sent to the interface */
+  uint64_t sent_mesh_updates = 0;
+  /** Number of element updates applied to the widgets */
+  uint64_t applied_updates = 0;
+  /** Number of element updates skipped because they were identical to the previous one */
+  uint64_t skipped_updates = 0;
+  /** Number of messages received in the background */
+  uint64_t received_messages = 0;
+  /** Number of messages received in the background that were superseded before they were applied */
+  uint64_t dropped_messages = 0;
+  /** Number of messages written by the current recording */
+  uint64_t recorded_messages = 0;
+};
+
 struct BlenderClient : public mc_rtc::imgui::Client
 {
   BlenderClient(Interface3D & gui) : mc_rtc::imgui::Client{}, gui_(gui) {}
 
+  /** Receive and handle the latest GUI messages
+   *
+   * If settings().background_receive is true, the messages are received and decoded in a background thread and only
+   * the latest decoded state is applied. The thread reads the SUB socket of the mc_rtc client so every message is
+   * received once, and the widgets are cleared when no message arrives for timeout() seconds as in the mc_rtc client.
+   */
+  void update();
+
+  /** Connect to the controller publishing on \p sub_uri and receiving requests on \p push_uri
+   *
+   * Use this rather than ControllerClient::connect, the background receiver is stopped before the SUB socket is
+   * replaced
+   */
+  void connect_controller(const std::string & sub_uri, const std::string & push_uri);
+
+  /** Record the GUI messages to \p path, an empty path stops the recording
+   *
+   * While recording the messages are received in the background regardless of settings().background_receive
+   *
+   * \returns False if the file cannot be created
+   */
+  bool record(const std::string & path);
+
+  /** True if the GUI messages are being recorded */
+  inline bool recording() const noexcept
+  {
+    return static_cast<bool>(recorder_);
+  }
+
+  /** Replay the recording at \p path instead of the messages of the controller, an empty path stops the replay
+   *
+   * \param speed Replay speed, 0 replays as fast as possible (only the latest message is applied on every update)
+   *
+   * \param loop Start again at the end of the recording, otherwise the client receives from the controller again once
+   * the last message of the recording was applied
+   *
+   * \returns False if the recording cannot be read
+   */
+  bool replay(const std::string & path, double speed = 1.0, bool loop = false);
+
+  /** True while a recording is being replayed */
+  inline bool replaying() const noexcept
+  {
+    return replay_ != nullptr;
+  }
+
+  /** Decode and apply a single GUI message, e.g. a message of a Recording
+   *
+   * \throws std::exception if the message cannot be decoded
+   */
+  void handle_message(const char * data, size_t size);
+
+  /** Draw the 2D interface, and the Performance window if settings().show_performance is true */
+  void draw2D(ImVec2 windowSize);
+
+  /** Update the 3D view */
+  void draw3D();
+
+  inline ClientSettings & settings() noexcept
+  {
+    return settings_;
+  }
+
+  inline ClientStats & stats() noexcept
+  {
+    return stats_;
+  }
+
+  /** Position of the viewport camera, used to pick the level of detail of the widgets */
+  inline const Eigen::Vector3d & camera() const noexcept
+  {
+    return camera_;
+  }
+
+  inline void camera(const Eigen::Vector3d & position) noexcept
+  {
+    camera_ = position;
+  }
+
+  /** Robots currently displayed by the client indexed by their full name (category and name joined by /) */
+  inline const std::map<std::string, Robot *> & robots() const noexcept
+  {
+    return robots_;
+  }
+
 private:
+  friend struct Robot;
+
+  /** Destroy source_, the next update() receives from the controller again */
+  void reset_source();
+
+  /** Returns true if the update of \p widget with \p fingerprint must be applied, \p interactive updates always are */
+  bool apply(Widget & widget, uint64_t fingerprint, bool interactive);
+
   Interface3D & gui_;
+  ClientSettings settings_;
+  ClientStats stats_;
+  Eigen::Vector3d camera_ = Eigen::Vector3d::Zero();
+  /** Receives messages in the background if settings_.background_receive is true, while recording or replaying */
+  std::unique_ptr<MessageSource> source_;
+  /** Points to source_ while receiving from the controller in the background */
+  SubscriberSource * subscriber_ = nullptr;
+  /** Points to source_ while replaying */
+  ReplaySource * replay_ = nullptr;
+  /** Time of the last state received from source_ */
+  std::chrono::steady_clock::time_point lastState_;
+  std::shared_ptr<Recorder> recorder_;
+  std::map<std::string, Robot *> robots_;
 
   void point3d(const ElementId & id,
                const ElementId & requestId,
@@ -0,0 +1,158 @@
+#include "DrawData.h"
+
+#include "Hash.h"
+
+#include <algorithm>
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+namespace mc_rtc::blender
+{
+
+namespace
+{
+
+/** Convert the colors of \p count vertices to floats in \p out */
+void convertColors(const ImDrawVert * vtx, size_t count, float * out)
+{
+  constexpr float scale = 1.0f / 255.0f;
+  size_t i = 0;
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 s = _mm_set1_ps(scale);
+  for(; i + 4 <= count; i += 4)
+  {
+    // Colors are packed as RGBA bytes, 4 vertices fill a register
+    __m128i c = _mm_set_epi32(static_cast<int>(vtx[i + 3].col), static_cast<int>(vtx[i + 2].col),
+                              static_cast<int>(vtx[i + 1].col), static_cast<int>(vtx[i].col));
+    __m128i lo = _mm_unpacklo_epi8(c, zero);
+    __m128i hi = _mm_unpackhi_epi8(c, zero);
+    float * o = out + 4 * i;
+    _mm_storeu_ps(o, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), s));
+    _mm_storeu_ps(o + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), s));
+    _mm_storeu_ps(o + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), s));
+    _mm_storeu_ps(o + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), s));
+  }
+#endif
+  for(; i < count; ++i)
+  {
+    ImU32 c = vtx[i].col;
+    float * o = out + 4 * i;
+    o[0] = static_cast<float>((c >> IM_COL32_R_SHIFT) & 0xFF) * scale;
+    o[1] = static_cast<float>((c >> IM_COL32_G_SHIFT) & 0xFF) * scale;
+    o[2] = static_cast<float>((c >> IM_COL32_B_SHIFT) & 0xFF) * scale;
+    o[3] = static_cast<float>((c >> IM_COL32_A_SHIFT) & 0xFF) * scale;
+  }
+}
+
+} // namespace
+
+void DrawDataExport::update(const ImDrawData & data)
+{
+  size_t nVertices = static_cast<size_t>(data.TotalVtxCount);
+  positions.resize(2 * nVertices);
+  uvs.resize(2 * nVertices);
+  colors.resize(4 * nVertices);
+  indices.resize(static_cast<size_t>(data.TotalIdxCount));
+  lists.clear();
+  commands.clear();
+  textures.clear();
+  clip_rects.clear();
+  merged_commands = 0;
+  uint32_t vtxOffset = 0;
+  uint32_t idxOffset = 0;
+  for(int l = 0; l < data.CmdListsCount; ++l)
+  {
+    const ImDrawList & list = *data.CmdLists[l];
+    const auto * vtx = list.VtxBuffer.Data;
+    size_t count = static_cast<size_t>(list.VtxBuffer.Size);
+    float * pos = &positions[2 * vtxOffset];
+    float * uv = &uvs[2 * vtxOffset];
+    for(size_t i = 0; i < count; ++i)
+    {
+      pos[2 * i] = vtx[i].pos.x;
+      pos[2 * i + 1] = vtx[i].pos.y;
+      uv[2 * i] = vtx[i].uv.x;
+      uv[2 * i + 1] = vtx[i].uv.y;
+    }
+    convertColors(vtx, count, &colors[4 * vtxOffset]);
+    lists.push_back(vtxOffset);
+    lists.push_back(static_cast<uint32_t>(count));
+    // True if the last exported command belongs to this list and can be extended
+    bool canMerge = false;
+    for(const auto & cmd : list.CmdBuffer)
+    {
+      if(cmd.UserCallback)
+      {
+        canMerge = false;
+        continue;
+      }
+      if(cmd.ElemCount == 0)
+      {
+        continue;
+      }
+      // Bake VtxOffset in the indices so that every command of a list uses the same vertices
+      const auto * idx = list.IdxBuffer.Data + cmd.IdxOffset;
+      uint32_t * out = &indices[idxOffset];
+      for(unsigned int i = 0; i < cmd.ElemCount; ++i)
+      {
+        out[i] = static_cast<uint32_t>(idx[i]) + cmd.VtxOffset;
+      }
+      auto texture = reinterpret_cast<uint64_t>(cmd.TextureId);
+      const auto & clip = cmd.ClipRect;
+      idxOffset += cmd.ElemCount;
+      // The indices of consecutive commands are contiguous so a command with the same state extends the previous one
+      if(canMerge && textures.back() == texture && std::equal(clip_rects.end() - 4, clip_rects.end(), &clip.x))
+      {
+        commands.back() += cmd.ElemCount;
+        merged_commands++;
+        continue;
+      }
+      commands.push_back(static_cast<uint32_t>(l));
+      commands.push_back(idxOffset - cmd.ElemCount);
+      commands.push_back(cmd.ElemCount);
+      textures.push_back(texture);
+      clip_rects.insert(clip_rects.end(), {clip.x, clip.y, clip.z, clip.w});
+      canMerge = true;
+    }
+    vtxOffset += static_cast<uint32_t>(count);
+  }
+  indices.resize(idxOffset);
+}
+
+uint64_t DrawDataFingerprint::compute(const ImDrawData & data)
+{
+  float frame[4] = {data.DisplaySize.x, data.DisplaySize.y, data.FramebufferScale.x, data.FramebufferScale.y};
+  uint64_t h = Hash::bytes(Hash::combine(0, static_cast<uint64_t>(data.CmdListsCount)), frame, sizeof(frame));
+  for(int l = 0; l < data.CmdListsCount; ++l)
+  {
+    const ImDrawList & list = *data.CmdLists[l];
+    h = Hash::combine(h, static_cast<uint64_t>(list.VtxBuffer.Size));
+    h = Hash::bytes(h, list.VtxBuffer.Data, sizeof(ImDrawVert) * static_cast<size_t>(list.VtxBuffer.Size));
+    h = Hash::combine(h, static_cast<uint64_t>(list.IdxBuffer.Size));
+    h = Hash::bytes(h, list.IdxBuffer.Data, sizeof(ImDrawIdx) * static_cast<size_t>(list.IdxBuffer.Size));
+    for(const auto & cmd : list.CmdBuffer)
+    {
+      h = Hash::bytes(h, &cmd.ClipRect, sizeof(cmd.ClipRect));
+      h = Hash::combine(h, reinterpret_cast<uint64_t>(cmd.TextureId));
+      h = Hash::combine(h, cmd.VtxOffset);
+      h = Hash::combine(h, cmd.IdxOffset);
+      h = Hash::combine(h, cmd.ElemCount);
+      h = Hash::combine(h, reinterpret_cast<uint64_t>(cmd.UserCallback));
+    }
+  }
+  return h;
+}
+
+bool DrawDataFingerprint::changed(const ImDrawData & data)
+{
+  uint64_t h = compute(data);
+  bool out = !valid_ || h != last_;
+  last_ = h;
+  valid_ = true;
+  return out;
+}
+
+} // namespace mc_rtc::blender
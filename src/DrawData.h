@@ -0,0 +1,61 @@
+#pragma once
+
+#include <imgui.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace mc_rtc::blender
+{
+
+/** Flat copy of the ImGui draw data of a frame, in a layout that can be uploaded directly
+ *
+ * The buffers are re-used from one frame to the next, their content is only valid until the next update
+ */
+struct DrawDataExport
+{
+  /** Vertices positions, 2 values per vertex */
+  std::vector<float> positions;
+  /** Vertices texture coordinates, 2 values per vertex */
+  std::vector<float> uvs;
+  /** Vertices colors as RGBA in [0, 1], 4 values per vertex */
+  std::vector<float> colors;
+  /** Indices of the vertices relative to the first vertex of their draw list */
+  std::vector<uint32_t> indices;
+  /** For each draw list, the offset of its first vertex and its number of vertices */
+  std::vector<uint32_t> lists;
+  /** For each command, its draw list, the offset of its first index and its number of indices */
+  std::vector<uint32_t> commands;
+  /** Texture of each command */
+  std::vector<uint64_t> textures;
+  /** Clipping rectangle of each command (x1, y1, x2, y2) */
+  std::vector<float> clip_rects;
+  /** Number of ImGui commands merged into the previous command because they use the same texture and clipping */
+  size_t merged_commands = 0;
+
+  /** Number of values in lists/commands per draw list/command */
+  static constexpr size_t LIST_SIZE = 2;
+  static constexpr size_t COMMAND_SIZE = 3;
+
+  /** Replace the content with \p data
+   *
+   * Consecutive commands of a draw list that use the same texture and clipping rectangle are merged into one
+   */
+  void update(const ImDrawData & data);
+};
+
+/** Detects changes in the draw data from one frame to the next */
+struct DrawDataFingerprint
+{
+  /** Hash of the vertices, indices and commands of \p data */
+  static uint64_t compute(const ImDrawData & data);
+
+  /** Returns true if \p data differs from the data given to the previous call */
+  bool changed(const ImDrawData & data);
+
+private:
+  uint64_t last_ = 0;
+  bool valid_ = false;
+};
+
+} // namespace mc_rtc::blender
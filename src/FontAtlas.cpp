@@ -0,0 +1,186 @@
+#include "FontAtlas.h"
+
+#include "Hash.h"
+
+#include "assets/Robot_Regular_ttf.h"
+
+#include <mc_rtc/logging.h>
+
+#include <boost/filesystem.hpp>
+namespace bfs = boost::filesystem;
+
+#include <cstring>
+#include <fstream>
+
+namespace mc_rtc::blender
+{
+
+namespace
+{
+
+/** Identifies cache files, to be changed if the format changes */
+constexpr uint64_t CACHE_MAGIC = 0x6d63727463666e74; // "mcrtcfnt"
+
+template<typename T>
+void write(std::ostream & os, const T & value)
+{
+  os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template<typename T>
+void write(std::ostream & os, const ImVector<T> & values)
+{
+  write(os, values.Size);
+  os.write(reinterpret_cast<const char *>(values.Data), static_cast<std::streamsize>(sizeof(T)) * values.Size);
+}
+
+template<typename T>
+bool read(std::istream & is, T & value)
+{
+  return static_cast<bool>(is.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+template<typename T>
+bool read(std::istream & is, ImVector<T> & values)
+{
+  int size = 0;
+  if(!read(is, size) || size < 0 || size > (1 << 20))
+  {
+    return false;
+  }
+  values.resize(size);
+  auto bytes = static_cast<std::streamsize>(sizeof(T)) * size;
+  return static_cast<bool>(is.read(reinterpret_cast<char *>(values.Data), bytes));
+}
+
+/** Everything that affects the rasterized atlas */
+uint64_t cacheKey(const ImFontAtlas & atlas, float size)
+{
+  uint64_t h = Hash::bytes(CACHE_MAGIC, Roboto_Regular_ttf, Roboto_Regular_ttf_len);
+  h = Hash::bytes(h, &size, sizeof(size));
+  h = Hash::combine(h, IMGUI_VERSION_NUM);
+  h = Hash::combine(h, sizeof(ImFontGlyph));
+  h = Hash::combine(h, sizeof(ImFontAtlasCustomRect));
+  h = Hash::combine(h, static_cast<uint64_t>(atlas.Flags));
+  h = Hash::combine(h, static_cast<uint64_t>(atlas.TexDesiredWidth));
+  return Hash::combine(h, static_cast<uint64_t>(atlas.TexGlyphPadding));
+}
+
+bool save(const ImFontAtlas & atlas, uint64_t key, const bfs::path & path)
+{
+  for(const auto & r : atlas.CustomRects)
+  {
+    // Custom glyphs reference a font that cannot be restored
+    if(r.Font)
+    {
+      return false;
+    }
+  }
+  bfs::create_directories(path.parent_path());
+  auto tmp = path;
+  tmp += ".tmp";
+  {
+    std::ofstream ofs(tmp.string(), std::ios::binary);
+    const ImFont & font = *atlas.Fonts[0];
+    write(ofs, key);
+    write(ofs, atlas.TexWidth);
+    write(ofs, atlas.TexHeight);
+    write(ofs, atlas.TexUvScale);
+    write(ofs, atlas.TexUvWhitePixel);
+    write(ofs, atlas.TexUvLines);
+    write(ofs, atlas.PackIdMouseCursors);
+    write(ofs, atlas.PackIdLines);
+    write(ofs, atlas.CustomRects);
+    write(ofs, font.FontSize);
+    write(ofs, font.Ascent);
+    write(ofs, font.Descent);
+    write(ofs, font.FallbackChar);
+    write(ofs, font.EllipsisChar);
+    write(ofs, font.MetricsTotalSurface);
+    write(ofs, font.Glyphs);
+    ofs.write(reinterpret_cast<const char *>(atlas.TexPixelsAlpha8),
+              static_cast<std::streamsize>(atlas.TexWidth) * atlas.TexHeight);
+    if(!ofs)
+    {
+      return false;
+    }
+  }
+  bfs::rename(tmp, path);
+  return true;
+}
+
+bool restore(ImFontAtlas & atlas, ImFont & font, uint64_t key, const bfs::path & path)
+{
+  std::ifstream ifs(path.string(), std::ios::binary);
+  uint64_t fileKey = 0;
+  if(!ifs || !read(ifs, fileKey) || fileKey != key)
+  {
+    return false;
+  }
+  bool ok = read(ifs, atlas.TexWidth) && read(ifs, atlas.TexHeight) && read(ifs, atlas.TexUvScale)
+            && read(ifs, atlas.TexUvWhitePixel) && read(ifs, atlas.TexUvLines) && read(ifs, atlas.PackIdMouseCursors)
+            && read(ifs, atlas.PackIdLines) && read(ifs, atlas.CustomRects) && read(ifs, font.FontSize)
+            && read(ifs, font.Ascent) && read(ifs, font.Descent) && read(ifs, font.FallbackChar)
+            && read(ifs, font.EllipsisChar) && read(ifs, font.MetricsTotalSurface) && read(ifs, font.Glyphs);
+  if(!ok || atlas.TexWidth <= 0 || atlas.TexHeight <= 0 || atlas.TexWidth * atlas.TexHeight > (1 << 26))
+  {
+    return false;
+  }
+  size_t pixels = static_cast<size_t>(atlas.TexWidth) * static_cast<size_t>(atlas.TexHeight);
+  atlas.TexPixelsAlpha8 = static_cast<unsigned char *>(IM_ALLOC(pixels));
+  if(!ifs.read(reinterpret_cast<char *>(atlas.TexPixelsAlpha8), static_cast<std::streamsize>(pixels)))
+  {
+    return false;
+  }
+  font.ContainerAtlas = &atlas;
+  font.ConfigData = &atlas.ConfigData[0];
+  font.ConfigDataCount = 1;
+  font.BuildLookupTable();
+  return true;
+}
+
+} // namespace
+
+bool build_font_atlas(ImFontAtlas & atlas, float size, float scale, const std::string & cacheDir)
+{
+  atlas.Clear();
+  ImFontConfig config;
+  // The data is static
+  config.FontDataOwnedByAtlas = false;
+  std::strncpy(config.Name, "Roboto-Regular", sizeof(config.Name) - 1);
+  float pixelSize = size * scale;
+  ImFont * font = atlas.AddFontFromMemoryTTF(Roboto_Regular_ttf, static_cast<int>(Roboto_Regular_ttf_len), pixelSize,
+                                             &config);
+  if(cacheDir.empty())
+  {
+    atlas.Build();
+    return false;
+  }
+  uint64_t key = cacheKey(atlas, pixelSize);
+  auto path = bfs::path(cacheDir) / fmt::format("font-{:016x}.bin", key);
+  if(bfs::exists(path))
+  {
+    if(restore(atlas, *font, key, path))
+    {
+      return true;
+    }
+    mc_rtc::log::warning("Replacing invalid font cache {}", path.string());
+    bfs::remove(path);
+    return build_font_atlas(atlas, size, scale, cacheDir);
+  }
+  atlas.Build();
+  try
+  {
+    if(!save(atlas, key, path))
+    {
+      mc_rtc::log::warning("Failed to save the font cache {}", path.string());
+    }
+  }
+  catch(const std::exception & exc)
+  {
+    mc_rtc::log::warning("Failed to save the font cache {}: {}", path.string(), exc.what());
+  }
+  return false;
+}
+
+} // namespace mc_rtc::blender
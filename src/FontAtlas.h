@@ -0,0 +1,20 @@
+#pragma once
+
+#include <imgui.h>
+
+#include <string>
+
+namespace mc_rtc::blender
+{
+
+/** Replace the fonts of \p atlas with the embedded Roboto font rasterized at \p size * \p scale
+ *
+ * The rasterized atlas is cached in \p cacheDir, keyed by the font data, its size and the scale. Later calls with the
+ * same parameters restore the atlas from the cache instead of rasterizing the font again. No cache is used if \p
+ * cacheDir is empty.
+ *
+ * \returns true if the atlas was restored from the cache
+ */
+bool build_font_atlas(ImFontAtlas & atlas, float size, float scale, const std::string & cacheDir);
+
+} // namespace mc_rtc::blender
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace mc_rtc::blender
+{
+
+/** Fast non-cryptographic 64-bit hashing (FxHash)
+ *
+ * This is meant to detect changes in data we produced or read ourselves, it offers no protection against collisions
+ * crafted on purpose
+ */
+struct Hash
+{
+  static constexpr uint64_t SEED = 0x517cc1b727220a95;
+
+  /** Mix \p word into \p h */
+  static constexpr uint64_t combine(uint64_t h, uint64_t word) noexcept
+  {
+    return (((h << 5) | (h >> 59)) ^ word) * SEED;
+  }
+
+  /** Mix \p size bytes from \p data into \p h
+   *
+   * Hashing a buffer in several calls gives the same result as a single call as long as every call but the last one
+   * has a size that is a multiple of 8
+   */
+  static uint64_t bytes(uint64_t h, const void * data, size_t size) noexcept
+  {
+    const auto * in = static_cast<const unsigned char *>(data);
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8)
+    {
+      uint64_t word;
+      std::memcpy(&word, in + i, 8);
+      h = combine(h, word);
+    }
+    if(i < size)
+    {
+      uint64_t word = 0;
+      std::memcpy(&word, in + i, size - i);
+      h = combine(h, word);
+    }
+    return h;
+  }
+};
+
+} // namespace mc_rtc::blender
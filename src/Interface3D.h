@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -10,78 +12,204 @@
 
 #include "widgets/details/ControlAxis.h"
 
-/** Virtual interface that deals with Blender */
+namespace mc_rtc::blender
+{
+
+struct MeshData;
+
+} // namespace mc_rtc::blender
+
+/** Virtual interface that deals with Blender
+ *
+ * Every object created through this interface is identified by a handle obtained from acquire_handle(). Handles are
+ * dense: the implementation can store its objects in a flat table indexed by the handle.
+ */
 struct Interface3D
 {
+  /** Identifier of an object created through this interface */
+  using Handle = uint32_t;
+
   virtual ~Interface3D() = default;
 
-  virtual std::string add_collection(const std::vector<std::string> &, const std::string &) = 0;
+  virtual void add_collection(Handle collection, const std::vector<std::string> & category, const std::string & name) = 0;
+
+  virtual void hide_collection(Handle collection, bool hide) = 0;
+
+  virtual void remove_collection(Handle collection) = 0;
+
+  /** Load a mesh
+   *
+   * \param data Geometry of the mesh if it was already decoded, nullptr otherwise
+   */
+  virtual void load_mesh(Handle mesh,
+                         Handle collection,
+                         const std::string & meshPath,
+                         const std::string & meshName,
+                         const std::array<double, 4> & defaultColor,
+                         const std::shared_ptr<const mc_rtc::blender::MeshData> & data) = 0;
+
+  virtual void set_mesh_position(Handle mesh, const sva::PTransformd & pose) = 0;
+
+  /** Set the position of many meshes at once
+   *
+   * \param meshes Handles of the meshes
+   *
+   * \param poses For each mesh, the translation and the (w, x, y, z) quaternion of its world orientation, this holds
+   * 7 * meshes.size() values
+   */
+  virtual void set_mesh_positions(const std::vector<Handle> & meshes, const std::vector<float> & poses) = 0;
+
+  virtual void remove_mesh(Handle mesh) = 0;
 
-  virtual void hide_collection(const std::string &, bool) = 0;
+  virtual void add_interactive_marker(Handle marker,
+                                      const std::vector<std::string> & category,
+                                      const std::string & name,
+                                      const mc_rtc::blender::ControlAxis & axis,
+                                      const std::function<void(const sva::PTransformd &)> & callback) = 0;
 
-  virtual void remove_collection(const std::string &) = 0;
+  virtual void update_interactive_marker(Handle marker, bool ro, const sva::PTransformd & pos) = 0;
 
-  virtual std::string load_mesh(const std::string & collection,
-                                const std::string & meshPath,
-                                const std::string & meshName,
-                                const std::array<double, 4> & defaultColor) = 0;
+  virtual void set_marker_hidden(Handle marker, bool hidden) = 0;
 
-  virtual void set_mesh_position(const std::string & meshName, const sva::PTransformd & pose) = 0;
+  virtual void remove_interactive_marker(Handle marker) = 0;
 
-  virtual void remove_mesh(const std::string & meshName) = 0;
+  virtual void add_arrow(Handle arrow, const std::vector<std::string> & category, const std::string & name) = 0;
 
-  virtual std::string add_interactive_marker(const std::vector<std::string> & category,
-                                             const std::string & name,
-                                             const mc_rtc::blender::ControlAxis & axis,
-                                             const std::function<void(const sva::PTransformd &)> & callback) = 0;
+  virtual void update_arrow(Handle arrow, const Eigen::Vector3d & start, const Eigen::Vector3d & end, double shaft_diam, double head_diam, double head_len, const std::array<double, 4> & color) = 0;
 
-  virtual void update_interactive_marker(const std::string & name, bool ro, const sva::PTransformd & pos) = 0;
+  virtual void remove_arrow(Handle arrow) = 0;
 
-  virtual void set_marker_hidden(const std::string & name, bool hidden) = 0;
+  virtual void add_polyline(Handle polyline, const std::vector<std::string> & category, const std::string & name) = 0;
 
-  virtual void remove_interactive_marker(const std::string & name) = 0;
+  /** Set the color and the width (in meters) of a polyline */
+  virtual void set_polyline_style(Handle polyline, const std::array<double, 4> & color, double width) = 0;
 
-  virtual std::string add_arrow(const std::vector<std::string> & category, const std::string & name) = 0;
+  /** Replace the points of a polyline, \p points holds 3 values per point */
+  virtual void set_polyline(Handle polyline, const std::vector<float> & points) = 0;
 
-  virtual void update_arrow(const std::string & name, const Eigen::Vector3d & start, const Eigen::Vector3d & end, double shaft_diam, double head_diam, double head_len, const std::array<double, 4> & color) = 0;
+  /** Add points at the end of a polyline, \p points holds 3 values per point */
+  virtual void append_polyline(Handle polyline, const std::vector<float> & points) = 0;
 
-  virtual void remove_arrow(const std::string & name) = 0;
+  /** Draw a cube at \p start and a sphere at \p end of a polyline, they are hidden if \p size is 0 */
+  virtual void set_polyline_markers(Handle polyline,
+                                    const Eigen::Vector3d & start,
+                                    const Eigen::Vector3d & end,
+                                    double size) = 0;
+
+  /** Draw frames along a polyline
+   *
+   * \param poses Poses of the frames in the layout used by set_mesh_positions, 7 values per frame
+   */
+  virtual void set_polyline_frames(Handle polyline, const std::vector<float> & poses) = 0;
+
+  virtual void remove_polyline(Handle polyline) = 0;
+
+  /** Get a handle for a new object, released handles are re-used first */
+  Handle acquire_handle()
+  {
+    if(freeHandles_.size())
+    {
+      auto h = freeHandles_.back();
+      freeHandles_.pop_back();
+      return h;
+    }
+    return nextHandle_++;
+  }
+
+  /** Release a handle once the associated object has been removed */
+  void release_handle(Handle h)
+  {
+    freeHandles_.push_back(h);
+  }
 
   struct Arrow
   {
     Arrow(Interface3D & parent,
           const std::vector<std::string> & category,
           const std::string & name)
-    : parent_(parent), name_(parent_.add_arrow(category, name))
+    : parent_(parent), handle_(parent_.acquire_handle())
     {
+      parent_.add_arrow(handle_, category, name);
     }
 
     ~Arrow()
     {
-      parent_.remove_arrow(name_);
+      parent_.remove_arrow(handle_);
+      parent_.release_handle(handle_);
     }
 
     void update(const Eigen::Vector3d & start, const Eigen::Vector3d & end, const mc_rtc::gui::ArrowConfig & config)
     {
       const auto & c = config.color;
-      parent_.update_arrow(name_, start, end, config.shaft_diam, config.head_diam, config.head_diam, {c.r, c.g, c.b, c.a});
+      parent_.update_arrow(handle_, start, end, config.shaft_diam, config.head_diam, config.head_diam, {c.r, c.g, c.b, c.a});
     }
   private:
     Interface3D & parent_;
-    std::string name_;
+    Handle handle_;
   };
+
+  struct Polyline
+  {
+    Polyline(Interface3D & parent, const std::vector<std::string> & category, const std::string & name)
+    : parent_(parent), handle_(parent_.acquire_handle())
+    {
+      parent_.add_polyline(handle_, category, name);
+    }
+
+    ~Polyline()
+    {
+      parent_.remove_polyline(handle_);
+      parent_.release_handle(handle_);
+    }
+
+    void style(const mc_rtc::gui::LineConfig & config)
+    {
+      const auto & c = config.color;
+      parent_.set_polyline_style(handle_, {c.r, c.g, c.b, c.a}, config.width);
+    }
+
+    void set(const std::vector<float> & points)
+    {
+      parent_.set_polyline(handle_, points);
+    }
+
+    void append(const std::vector<float> & points)
+    {
+      parent_.append_polyline(handle_, points);
+    }
+
+    void markers(const Eigen::Vector3d & start, const Eigen::Vector3d & end, double size)
+    {
+      parent_.set_polyline_markers(handle_, start, end, size);
+    }
+
+    void frames(const std::vector<float> & poses)
+    {
+      parent_.set_polyline_frames(handle_, poses);
+    }
+
+  private:
+    Interface3D & parent_;
+    Handle handle_;
+  };
+
+private:
+  Handle nextHandle_ = 0;
+  std::vector<Handle> freeHandles_;
 };
 
 struct Collection
 {
   Collection(Interface3D & parent, const std::vector<std::string> & category, const std::string & name)
-  : parent_(parent), collection_(gui().add_collection(category, name))
+  : parent_(parent), collection_(gui().acquire_handle())
   {
+    gui().add_collection(collection_, category, name);
   }
 
   ~Collection()
   {
     gui().remove_collection(collection_);
+    gui().release_handle(collection_);
   }
 
   void hide(bool h)
@@ -94,14 +222,14 @@ struct Collection
     return parent_.get();
   }
 
-  const std::string & collection()
+  Interface3D::Handle collection() const
   {
     return collection_;
   }
 
 private:
   std::reference_wrapper<Interface3D> parent_;
-  std::string collection_;
+  Interface3D::Handle collection_;
 };
 
 struct Mesh
@@ -109,22 +237,30 @@ struct Mesh
   Mesh(Collection & collection,
        const std::string & meshPath,
        const std::string & meshName,
-       const std::array<double, 4> & defaultColor)
-  : collection_(collection), name_(gui().load_mesh(this->collection(), meshPath, meshName, defaultColor))
+       const std::array<double, 4> & defaultColor,
+       const std::shared_ptr<const mc_rtc::blender::MeshData> & data = nullptr)
+  : collection_(collection), handle_(gui().acquire_handle())
   {
+    gui().load_mesh(handle_, this->collection(), meshPath, meshName, defaultColor, data);
   }
 
   ~Mesh()
   {
-    gui().remove_mesh(name_);
+    gui().remove_mesh(handle_);
+    gui().release_handle(handle_);
   }
 
   void set_position(const sva::PTransformd & pos)
   {
-    gui().set_mesh_position(name_, pos);
+    gui().set_mesh_position(handle_, pos);
   }
 
-  const std::string & collection()
+  Interface3D::Handle handle() const
+  {
+    return handle_;
+  }
+
+  Interface3D::Handle collection() const
   {
     return collection_.get().collection();
   }
@@ -136,5 +272,96 @@ struct Mesh
 
 private:
   std::reference_wrapper<Collection> collection_;
-  std::string name_;
+  Interface3D::Handle handle_;
+};
+
+/** Collect the poses of several meshes to send them in a single set_mesh_positions call */
+struct MeshBatch
+{
+  /** Number of values used to store a pose */
+  static constexpr size_t POSE_SIZE = 7;
+
+  /** Write \p pose in \p out as [tx, ty, tz, qw, qx, qy, qz] */
+  static void write_pose(const sva::PTransformd & pose, float * out)
+  {
+    const auto & t = pose.translation();
+    Eigen::Quaterniond q(pose.rotation().transpose());
+    q.normalize();
+    out[0] = static_cast<float>(t.x());
+    out[1] = static_cast<float>(t.y());
+    out[2] = static_cast<float>(t.z());
+    out[3] = static_cast<float>(q.w());
+    out[4] = static_cast<float>(q.x());
+    out[5] = static_cast<float>(q.y());
+    out[6] = static_cast<float>(q.z());
+  }
+
+  /** Add a mesh to the batch, returns its index in the batch */
+  size_t add(const Mesh & mesh)
+  {
+    meshes_.push_back(mesh.handle());
+    poses_->resize(POSE_SIZE * meshes_.size(), 0.0f);
+    return meshes_.size() - 1;
+  }
+
+  /** Set the pose of the mesh at \p idx, the mesh will be updated by the next send() call */
+  void set(size_t idx, const sva::PTransformd & pose)
+  {
+    float * out = &(*poses_)[POSE_SIZE * idx];
+    write_pose(pose, out);
+    pendingMeshes_.push_back(meshes_[idx]);
+    pendingPoses_.insert(pendingPoses_.end(), out, out + POSE_SIZE);
+  }
+
+  /** Remove all meshes from the batch
+   *
+   * A new pose buffer is used afterwards so that users of poses() keep a valid buffer
+   */
+  void clear()
+  {
+    meshes_.clear();
+    poses_ = std::make_shared<std::vector<float>>();
+    discard();
+  }
+
+  /** Number of meshes in the batch */
+  size_t size() const noexcept
+  {
+    return meshes_.size();
+  }
+
+  /** Number of meshes updated since the last send() */
+  size_t pending() const noexcept
+  {
+    return pendingMeshes_.size();
+  }
+
+  /** Send the poses set since the last call to the interface */
+  void send(Interface3D & gui)
+  {
+    if(pendingMeshes_.size())
+    {
+      gui.set_mesh_positions(pendingMeshes_, pendingPoses_);
+    }
+    discard();
+  }
+
+  /** Forget the poses set since the last send() */
+  void discard()
+  {
+    pendingMeshes_.clear();
+    pendingPoses_.clear();
+  }
+
+  /** Poses of all meshes in the batch */
+  std::shared_ptr<const std::vector<float>> poses() const noexcept
+  {
+    return poses_;
+  }
+
+private:
+  std::vector<Interface3D::Handle> meshes_;
+  std::shared_ptr<std::vector<float>> poses_ = std::make_shared<std::vector<float>>();
+  std::vector<Interface3D::Handle> pendingMeshes_;
+  std::vector<float> pendingPoses_;
 };
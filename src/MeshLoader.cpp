@@ -0,0 +1,608 @@
+#include "MeshLoader.h"
+
+#include "Hash.h"
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+namespace bfs = boost::filesystem;
+namespace pt = boost::property_tree;
+
+#include <Eigen/Geometry>
+
+#ifdef __APPLE__
+#  include <xlocale.h>
+#endif
+#include <locale.h>
+
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <locale>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace mc_rtc::blender
+{
+
+namespace
+{
+
+const std::array<float, 4> DEFAULT_COLOR = {0.8f, 0.8f, 0.8f, 1.0f};
+
+std::string readFile(const std::string & path)
+{
+  std::ifstream ifs(path, std::ios::binary);
+  if(!ifs)
+  {
+    throw std::runtime_error("Cannot open " + path);
+  }
+  std::ostringstream ss;
+  ss << ifs.rdbuf();
+  return ss.str();
+}
+
+/** The "C" locale used to parse numbers, the global locale might use another decimal separator (e.g. in Blender) */
+locale_t cLocale()
+{
+  static locale_t locale = newlocale(LC_ALL_MASK, "C", nullptr);
+  return locale;
+}
+
+std::vector<float> parseFloats(const std::string & text)
+{
+  std::vector<float> out;
+  const char * s = text.c_str();
+  char * end = nullptr;
+  while(true)
+  {
+    float f = strtof_l(s, &end, cLocale());
+    if(end == s)
+    {
+      return out;
+    }
+    out.push_back(f);
+    s = end;
+  }
+}
+
+std::vector<int32_t> parseInts(const std::string & text)
+{
+  std::vector<int32_t> out;
+  const char * s = text.c_str();
+  char * end = nullptr;
+  while(true)
+  {
+    long i = std::strtol(s, &end, 10);
+    if(end == s)
+    {
+      return out;
+    }
+    out.push_back(static_cast<int32_t>(i));
+    s = end;
+  }
+}
+
+/** Adds vertices to a MeshData, vertices with the same position are only added once */
+struct VertexSet
+{
+  VertexSet(MeshData & data) : data_(data) {}
+
+  int32_t add(const float * v)
+  {
+    Key key;
+    std::memcpy(key.data(), v, sizeof(Key));
+    auto it = indices_.find(key);
+    if(it != indices_.end())
+    {
+      return it->second;
+    }
+    auto idx = static_cast<int32_t>(data_.vertices.size() / 3);
+    data_.vertices.insert(data_.vertices.end(), v, v + 3);
+    indices_[key] = idx;
+    return idx;
+  }
+
+private:
+  using Key = std::array<uint32_t, 3>;
+  struct KeyHash
+  {
+    size_t operator()(const Key & k) const noexcept
+    {
+      return Hash::combine(Hash::combine(Hash::combine(0, k[0]), k[1]), k[2]);
+    }
+  };
+  MeshData & data_;
+  std::unordered_map<Key, int32_t, KeyHash> indices_;
+};
+
+void loadBinarySTL(const std::string & content, MeshData & out)
+{
+  uint32_t nTriangles;
+  std::memcpy(&nTriangles, content.data() + 80, sizeof(uint32_t));
+  VertexSet vertices(out);
+  out.triangles.reserve(3 * nTriangles);
+  for(size_t i = 0; i < nTriangles; ++i)
+  {
+    // Each triangle is: normal (3 floats), 3 vertices (3 floats each), attributes (2 bytes)
+    const char * triangle = content.data() + 84 + 50 * i;
+    for(size_t j = 0; j < 3; ++j)
+    {
+      float v[3];
+      std::memcpy(v, triangle + 12 * (j + 1), sizeof(v));
+      out.triangles.push_back(vertices.add(v));
+    }
+  }
+}
+
+void loadASCIISTL(const std::string & content, MeshData & out)
+{
+  std::istringstream iss(content);
+  iss.imbue(std::locale::classic());
+  VertexSet vertices(out);
+  std::string word;
+  while(iss >> word)
+  {
+    if(word != "vertex")
+    {
+      continue;
+    }
+    float v[3];
+    if(!(iss >> v[0] >> v[1] >> v[2]))
+    {
+      throw std::runtime_error("Invalid vertex in ASCII STL");
+    }
+    out.triangles.push_back(vertices.add(v));
+  }
+  if(out.triangles.size() % 3 != 0)
+  {
+    throw std::runtime_error("Incomplete facet in ASCII STL");
+  }
+}
+
+void loadSTL(const std::string & path, MeshData & out)
+{
+  auto content = readFile(path);
+  bool binary = false;
+  if(content.size() >= 84)
+  {
+    uint32_t nTriangles;
+    std::memcpy(&nTriangles, content.data() + 80, sizeof(uint32_t));
+    // Some binary files start with "solid" too, the size tells them apart
+    binary = content.size() == 84 + 50 * static_cast<size_t>(nTriangles);
+  }
+  if(binary)
+  {
+    loadBinarySTL(content, out);
+  }
+  else if(content.compare(0, 5, "solid") == 0)
+  {
+    loadASCIISTL(content, out);
+  }
+  else
+  {
+    throw std::runtime_error("Invalid STL file");
+  }
+  out.triangle_materials.resize(out.triangles.size() / 3, 0);
+}
+
+/** Loads the geometry instantiated by the visual scene of a COLLADA document */
+struct ColladaLoader
+{
+  ColladaLoader(const pt::ptree & root, MeshData & out) : root_(root), out_(out)
+  {
+    for(const auto & e : child(root_, "library_effects"))
+    {
+      if(e.first == "effect")
+      {
+        loadEffect(e.second);
+      }
+    }
+    for(const auto & m : child(root_, "library_materials"))
+    {
+      if(m.first == "material")
+      {
+        const auto & id = attribute(m.second, "id");
+        auto effect = target(attribute(child(m.second, "instance_effect"), "url"));
+        materials_[id] = {attribute(m.second, "name", id), effect};
+      }
+    }
+    for(const auto & g : child(root_, "library_geometries"))
+    {
+      if(g.first == "geometry" && g.second.count("mesh"))
+      {
+        geometries_[attribute(g.second, "id")] = &g.second.get_child("mesh");
+      }
+    }
+    for(const auto & n : child(root_, "library_nodes"))
+    {
+      if(n.first == "node")
+      {
+        nodes_[attribute(n.second, "id")] = &n.second;
+      }
+    }
+  }
+
+  void load()
+  {
+    double meter = root_.get<double>("asset.unit.<xmlattr>.meter", 1.0);
+    auto up = root_.get<std::string>("asset.up_axis", "Y_UP");
+    boost::algorithm::trim(up);
+    Eigen::Matrix4d M = Eigen::Matrix4d::Identity();
+    if(up == "Y_UP")
+    {
+      M.block<3, 3>(0, 0) = Eigen::AngleAxisd(M_PI / 2, Eigen::Vector3d::UnitX()).toRotationMatrix();
+    }
+    else if(up == "X_UP")
+    {
+      M.block<3, 3>(0, 0) = Eigen::AngleAxisd(-M_PI / 2, Eigen::Vector3d::UnitY()).toRotationMatrix();
+    }
+    M.block<3, 3>(0, 0) *= meter;
+    auto sceneId = target(root_.get<std::string>("scene.instance_visual_scene.<xmlattr>.url", ""));
+    for(const auto & s : child(root_, "library_visual_scenes"))
+    {
+      if(s.first == "visual_scene" && (sceneId.empty() || attribute(s.second, "id") == sceneId))
+      {
+        loadNode(s.second, M);
+        return;
+      }
+    }
+    throw std::runtime_error("No visual scene in COLLADA file");
+  }
+
+private:
+  struct Material
+  {
+    std::string name;
+    std::string effect;
+  };
+
+  const pt::ptree & root_;
+  MeshData & out_;
+  /** Diffuse color of the effects */
+  std::map<std::string, std::array<float, 4>> effects_;
+  std::map<std::string, Material> materials_;
+  std::map<std::string, const pt::ptree *> geometries_;
+  std::map<std::string, const pt::ptree *> nodes_;
+  /** Index in out_ of the materials already used */
+  std::map<std::string, int32_t> usedMaterials_;
+
+  static const pt::ptree & child(const pt::ptree & node, const std::string & path)
+  {
+    static const pt::ptree empty;
+    return node.get_child(path, empty);
+  }
+
+  static std::string attribute(const pt::ptree & node, const std::string & name, const std::string & def = "")
+  {
+    return node.get<std::string>("<xmlattr>." + name, def);
+  }
+
+  /** Strip the # in front of an URL referencing an element of the document */
+  static std::string target(const std::string & url)
+  {
+    return url.size() && url[0] == '#' ? url.substr(1) : url;
+  }
+
+  void loadEffect(const pt::ptree & effect)
+  {
+    auto color = DEFAULT_COLOR;
+    for(const auto & t : child(effect, "profile_COMMON.technique"))
+    {
+      if(t.first != "phong" && t.first != "lambert" && t.first != "blinn" && t.first != "constant")
+      {
+        continue;
+      }
+      const auto & diffuse = child(t.second, t.first == "constant" ? "emission" : "diffuse");
+      if(diffuse.count("texture"))
+      {
+        out_.textured = true;
+      }
+      auto values = parseFloats(diffuse.get<std::string>("color", ""));
+      if(values.size() == 4)
+      {
+        std::copy(values.begin(), values.end(), color.begin());
+      }
+    }
+    effects_[attribute(effect, "id")] = color;
+  }
+
+  int32_t material(const std::string & id)
+  {
+    auto it = usedMaterials_.find(id);
+    if(it != usedMaterials_.end())
+    {
+      return it->second;
+    }
+    auto idx = static_cast<int32_t>(out_.material_names.size());
+    auto color = DEFAULT_COLOR;
+    std::string name = id;
+    auto mIt = materials_.find(id);
+    if(mIt != materials_.end())
+    {
+      name = mIt->second.name;
+      auto eIt = effects_.find(mIt->second.effect);
+      if(eIt != effects_.end())
+      {
+        color = eIt->second;
+      }
+    }
+    out_.material_names.push_back(name);
+    out_.material_colors.insert(out_.material_colors.end(), color.begin(), color.end());
+    usedMaterials_[id] = idx;
+    return idx;
+  }
+
+  void loadNode(const pt::ptree & node, const Eigen::Matrix4d & parent)
+  {
+    Eigen::Matrix4d M = parent;
+    for(const auto & c : node)
+    {
+      const auto & tag = c.first;
+      if(tag == "matrix")
+      {
+        auto v = parseFloats(c.second.data());
+        if(v.size() == 16)
+        {
+          M = M * Eigen::Map<Eigen::Matrix<float, 4, 4, Eigen::RowMajor>>(v.data()).cast<double>();
+        }
+      }
+      else if(tag == "translate")
+      {
+        auto v = parseFloats(c.second.data());
+        if(v.size() == 3)
+        {
+          M = M * Eigen::Affine3d(Eigen::Translation3d(v[0], v[1], v[2])).matrix();
+        }
+      }
+      else if(tag == "rotate")
+      {
+        auto v = parseFloats(c.second.data());
+        if(v.size() == 4)
+        {
+          Eigen::Vector3d axis(v[0], v[1], v[2]);
+          M = M * Eigen::Affine3d(Eigen::AngleAxisd(v[3] * M_PI / 180, axis.normalized())).matrix();
+        }
+      }
+      else if(tag == "scale")
+      {
+        auto v = parseFloats(c.second.data());
+        if(v.size() == 3)
+        {
+          M = M * Eigen::Affine3d(Eigen::Scaling(Eigen::Vector3d(v[0], v[1], v[2]))).matrix();
+        }
+      }
+      else if(tag == "instance_geometry")
+      {
+        auto it = geometries_.find(target(attribute(c.second, "url")));
+        if(it != geometries_.end())
+        {
+          // Material symbols used in the geometry -> material id
+          std::map<std::string, std::string> symbols;
+          for(const auto & m : child(c.second, "bind_material.technique_common"))
+          {
+            if(m.first == "instance_material")
+            {
+              symbols[attribute(m.second, "symbol")] = target(attribute(m.second, "target"));
+            }
+          }
+          loadGeometry(*it->second, M, symbols);
+        }
+      }
+      else if(tag == "instance_node")
+      {
+        auto it = nodes_.find(target(attribute(c.second, "url")));
+        if(it != nodes_.end())
+        {
+          loadNode(*it->second, M);
+        }
+      }
+      else if(tag == "node")
+      {
+        loadNode(c.second, M);
+      }
+    }
+  }
+
+  void loadGeometry(const pt::ptree & mesh,
+                    const Eigen::Matrix4d & M,
+                    const std::map<std::string, std::string> & symbols)
+  {
+    std::map<std::string, const pt::ptree *> sources;
+    for(const auto & s : mesh)
+    {
+      if(s.first == "source")
+      {
+        sources[attribute(s.second, "id")] = &s.second;
+      }
+    }
+    std::string positionsId;
+    for(const auto & in : child(mesh, "vertices"))
+    {
+      if(in.first == "input" && attribute(in.second, "semantic") == "POSITION")
+      {
+        positionsId = target(attribute(in.second, "source"));
+      }
+    }
+    if(!sources.count(positionsId))
+    {
+      return;
+    }
+    const auto & positionsSource = *sources.at(positionsId);
+    auto positions = parseFloats(positionsSource.get<std::string>("float_array", ""));
+    size_t stride = positionsSource.get<size_t>("technique_common.accessor.<xmlattr>.stride", 3);
+    if(stride < 3)
+    {
+      return;
+    }
+    auto base = static_cast<int32_t>(out_.vertices.size() / 3);
+    int32_t nVertices = static_cast<int32_t>(positions.size() / stride);
+    for(int32_t i = 0; i < nVertices; ++i)
+    {
+      const float * p = &positions[stride * i];
+      Eigen::Vector3d v = (M * Eigen::Vector4d(p[0], p[1], p[2], 1.0)).head<3>();
+      out_.vertices.push_back(static_cast<float>(v.x()));
+      out_.vertices.push_back(static_cast<float>(v.y()));
+      out_.vertices.push_back(static_cast<float>(v.z()));
+    }
+    for(const auto & prim : mesh)
+    {
+      static const std::set<std::string> supported = {"triangles", "polylist", "polygons", "trifans", "tristrips"};
+      if(!supported.count(prim.first))
+      {
+        continue;
+      }
+      size_t nInputs = 0;
+      size_t vertexOffset = 0;
+      for(const auto & in : prim.second)
+      {
+        if(in.first == "input")
+        {
+          auto offset = in.second.get<size_t>("<xmlattr>.offset", 0);
+          nInputs = std::max(nInputs, offset + 1);
+          if(attribute(in.second, "semantic") == "VERTEX")
+          {
+            vertexOffset = offset;
+          }
+        }
+      }
+      if(nInputs == 0)
+      {
+        continue;
+      }
+      int32_t materialIdx = 0;
+      auto symbol = attribute(prim.second, "material");
+      if(symbol.size())
+      {
+        auto it = symbols.find(symbol);
+        materialIdx = material(it != symbols.end() ? it->second : symbol);
+      }
+      // Add the triangle made of the vertices a, b and c of the primitive p
+      auto triangle = [&](const std::vector<int32_t> & p, size_t a, size_t b, size_t c) {
+        for(auto i : {a, b, c})
+        {
+          int32_t idx = p[nInputs * i + vertexOffset];
+          if(idx < 0 || idx >= nVertices)
+          {
+            throw std::runtime_error("Invalid vertex index in COLLADA file");
+          }
+          out_.triangles.push_back(base + idx);
+        }
+        out_.triangle_materials.push_back(materialIdx);
+      };
+      if(prim.first == "triangles" || prim.first == "polylist")
+      {
+        auto p = parseInts(prim.second.get<std::string>("p", ""));
+        std::vector<int32_t> vcount;
+        if(prim.first == "polylist")
+        {
+          vcount = parseInts(prim.second.get<std::string>("vcount", ""));
+        }
+        else
+        {
+          vcount.resize(p.size() / (3 * nInputs), 3);
+        }
+        size_t start = 0;
+        for(auto n : vcount)
+        {
+          if(n < 3 || nInputs * (start + static_cast<size_t>(n)) > p.size())
+          {
+            break;
+          }
+          // Fan triangulation of the polygon
+          for(size_t i = 1; i + 1 < static_cast<size_t>(n); ++i)
+          {
+            triangle(p, start, start + i, start + i + 1);
+          }
+          start += static_cast<size_t>(n);
+        }
+        continue;
+      }
+      // polygons, trifans and tristrips hold one primitive per <p>, polygons with holes (<ph>) are not supported
+      for(const auto & c : prim.second)
+      {
+        if(c.first != "p")
+        {
+          continue;
+        }
+        auto p = parseInts(c.second.data());
+        size_t n = p.size() / nInputs;
+        for(size_t i = 1; i + 1 < n; ++i)
+        {
+          if(prim.first != "tristrips")
+          {
+            triangle(p, 0, i, i + 1);
+          }
+          else if(i % 2)
+          {
+            triangle(p, i - 1, i, i + 1);
+          }
+          else
+          {
+            // Every other triangle of a strip is flipped to keep the winding consistent
+            triangle(p, i, i - 1, i + 1);
+          }
+        }
+      }
+    }
+  }
+};
+
+void loadCollada(const std::string & path, MeshData & out)
+{
+  pt::ptree tree;
+  try
+  {
+    pt::read_xml(path, tree, pt::xml_parser::no_comments);
+  }
+  catch(const pt::xml_parser_error & exc)
+  {
+    throw std::runtime_error(exc.what());
+  }
+  auto root = tree.get_child_optional("COLLADA");
+  if(!root)
+  {
+    throw std::runtime_error("Not a COLLADA file");
+  }
+  ColladaLoader(*root, out).load();
+}
+
+} // namespace
+
+std::shared_ptr<MeshData> MeshData::load(const std::string & path)
+{
+  auto out = std::make_shared<MeshData>();
+  auto ext = boost::algorithm::to_lower_copy(bfs::path(path).extension().string());
+  try
+  {
+    if(ext == ".stl")
+    {
+      loadSTL(path, *out);
+    }
+    else if(ext == ".dae")
+    {
+      loadCollada(path, *out);
+    }
+    else
+    {
+      throw std::runtime_error("Unsupported format");
+    }
+    if(out->triangles.empty())
+    {
+      throw std::runtime_error("No supported geometry");
+    }
+  }
+  catch(const std::runtime_error & exc)
+  {
+    throw std::runtime_error("Failed to load " + path + ": " + exc.what());
+  }
+  return out;
+}
+
+} // namespace mc_rtc::blender
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mc_rtc::blender
+{
+
+/** Geometry of a mesh file ready to be sent to Blender
+ *
+ * The transformations and units of the file are applied to the vertices, the result is in meters with Z up
+ */
+struct MeshData
+{
+  /** Vertices positions, 3 values per vertex */
+  std::vector<float> vertices;
+  /** Triangles, 3 vertex indices per triangle */
+  std::vector<int32_t> triangles;
+  /** Material of each triangle, index in material_names */
+  std::vector<int32_t> triangle_materials;
+  /** Name of each material */
+  std::vector<std::string> material_names;
+  /** Diffuse color of each material, 4 values (RGBA) per material */
+  std::vector<float> material_colors;
+  /** True if the materials use textures, those are not loaded */
+  bool textured = false;
+
+  /** Load a STL (binary or ASCII) or COLLADA file
+   *
+   * \throws std::runtime_error if the file cannot be read or its format is not supported
+   */
+  static std::shared_ptr<MeshData> load(const std::string & path);
+};
+
+} // namespace mc_rtc::blender
@@ -0,0 +1,170 @@
+#include "MeshRegistry.h"
+
+#include "Hash.h"
+
+#include <mc_rtc/logging.h>
+
+#include <boost/filesystem.hpp>
+namespace bfs = boost::filesystem;
+
+#include <sys/stat.h>
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace mc_rtc::blender
+{
+
+namespace
+{
+
+/** First line of the index, to be changed if the format or the hash changes */
+const std::string INDEX_HEADER = "mc_rtc_blender mesh index 2";
+
+/** Get the size, modification time (ns) and inode of \p path, returns false if the file cannot be read */
+bool fileStatus(const std::string & path, uint64_t & size, int64_t & mtime, uint64_t & inode)
+{
+  struct stat st;
+  if(::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+  {
+    return false;
+  }
+#ifdef __APPLE__
+  const auto & t = st.st_mtimespec;
+#else
+  const auto & t = st.st_mtim;
+#endif
+  size = static_cast<uint64_t>(st.st_size);
+  mtime = static_cast<int64_t>(t.tv_sec) * 1000000000 + static_cast<int64_t>(t.tv_nsec);
+  inode = static_cast<uint64_t>(st.st_ino);
+  return true;
+}
+
+uint64_t hashFile(const std::string & path, bool & ok)
+{
+  std::ifstream ifs(path, std::ios::binary);
+  ok = ifs.good();
+  uint64_t h = 0;
+  // Multiple of 8 to hash the file in chunks, see Hash::bytes
+  std::vector<char> buffer(1 << 20);
+  while(ifs)
+  {
+    ifs.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    h = Hash::bytes(h, buffer.data(), static_cast<size_t>(ifs.gcount()));
+  }
+  ok = ok && ifs.eof();
+  return h;
+}
+
+} // namespace
+
+MeshRegistry::MeshRegistry(const std::string & index) : index_(index)
+{
+  if(index_.empty() || !bfs::exists(index_))
+  {
+    return;
+  }
+  std::ifstream ifs(index_);
+  std::string line;
+  if(!std::getline(ifs, line) || line != INDEX_HEADER)
+  {
+    mc_rtc::log::warning("Ignoring outdated mesh index {}", index_);
+    return;
+  }
+  while(std::getline(ifs, line))
+  {
+    std::istringstream iss(line);
+    Entry entry;
+    iss >> std::hex >> entry.hash >> std::dec >> entry.size >> entry.mtime >> entry.inode;
+    if(!iss || iss.get() != ' ')
+    {
+      continue;
+    }
+    std::string path;
+    std::getline(iss, path);
+    if(path.size())
+    {
+      entries_[path] = entry;
+    }
+  }
+}
+
+MeshRegistry::~MeshRegistry()
+{
+  try
+  {
+    save();
+  }
+  catch(const std::exception & exc)
+  {
+    mc_rtc::log::error("Failed to save the mesh index {}: {}", index_, exc.what());
+  }
+}
+
+uint64_t MeshRegistry::hash(const std::string & path)
+{
+  uint64_t size = 0;
+  int64_t mtime = 0;
+  uint64_t inode = 0;
+  if(!fileStatus(path, size, mtime, inode))
+  {
+    return 0;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(path);
+    if(it != entries_.end() && it->second.size == size && it->second.mtime == mtime && it->second.inode == inode)
+    {
+      cachedFiles_++;
+      return it->second.hash;
+    }
+  }
+  // Hash outside of the lock so that several files can be hashed at once
+  bool ok = false;
+  uint64_t h = Hash::combine(hashFile(path, ok), size);
+  if(!ok)
+  {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_[path] = {size, mtime, inode, h};
+  dirty_ = true;
+  hashedFiles_++;
+  return h;
+}
+
+void MeshRegistry::save()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if(index_.empty() || !dirty_)
+  {
+    return;
+  }
+  bfs::path index(index_);
+  if(index.has_parent_path())
+  {
+    bfs::create_directories(index.parent_path());
+  }
+  // Write to a temporary file first so that an interrupted save does not corrupt the index
+  bfs::path tmp = index;
+  tmp += ".tmp";
+  {
+    std::ofstream ofs(tmp.string());
+    ofs << INDEX_HEADER << '\n';
+    for(const auto & e : entries_)
+    {
+      ofs << std::hex << e.second.hash << std::dec << ' ' << e.second.size << ' ' << e.second.mtime << ' '
+          << e.second.inode << ' ' << e.first << '\n';
+    }
+    if(!ofs)
+    {
+      mc_rtc::log::error("Failed to write the mesh index {}", tmp.string());
+      return;
+    }
+  }
+  bfs::rename(tmp, index);
+  dirty_ = false;
+}
+
+} // namespace mc_rtc::blender
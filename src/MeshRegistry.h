@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace mc_rtc::blender
+{
+
+/** Keeps track of the content of mesh files
+ *
+ * The content hash of a file is only computed when its size, modification time (in nanoseconds) or inode changed since
+ * it was last seen. The known files can be saved to an index on disk so that they are not hashed again in later
+ * sessions.
+ */
+struct MeshRegistry
+{
+  /** Constructor
+   *
+   * \param index Index file, loaded if it exists and saved on destruction, no index is used if empty
+   */
+  MeshRegistry(const std::string & index = "");
+
+  /** Save the index */
+  ~MeshRegistry();
+
+  MeshRegistry(const MeshRegistry &) = delete;
+  MeshRegistry & operator=(const MeshRegistry &) = delete;
+
+  /** Returns the content hash of \p path, 0 if the file cannot be read */
+  uint64_t hash(const std::string & path);
+
+  /** Save the index if it changed since the last save */
+  void save();
+
+  /** Number of files hashed since the registry was created */
+  inline uint64_t hashed_files() const noexcept
+  {
+    return hashedFiles_;
+  }
+
+  /** Number of hashes served from the registry since it was created */
+  inline uint64_t cached_files() const noexcept
+  {
+    return cachedFiles_;
+  }
+
+private:
+  struct Entry
+  {
+    uint64_t size;
+    /** Modification time in nanoseconds, a file rewritten within the same second has a different one */
+    int64_t mtime;
+    /** A file replaced by a rename has a different inode even if it has the same size and modification time */
+    uint64_t inode;
+    uint64_t hash;
+  };
+
+  std::string index_;
+  std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  bool dirty_ = false;
+  uint64_t hashedFiles_ = 0;
+  uint64_t cachedFiles_ = 0;
+};
+
+} // namespace mc_rtc::blender
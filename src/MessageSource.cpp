@@ -0,0 +1,212 @@
+#include "MessageSource.h"
+
+#include "Tracer.h"
+
+#include <mc_rtc/logging.h>
+
+#include <nanomsg/nn.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace mc_rtc::blender
+{
+
+bool MessageSource::poll(mc_rtc::Configuration & state, double & decodeMs)
+{
+  if(!states_.update())
+  {
+    return false;
+  }
+  auto & latest = states_.front();
+  state = latest.state;
+  decodeMs = latest.decodeMs;
+  // Release the decoded state early, the worker overwrites this buffer later
+  latest.state = mc_rtc::Configuration{};
+  polled_++;
+  return true;
+}
+
+void MessageSource::record(std::shared_ptr<Recorder> recorder)
+{
+  std::lock_guard<std::mutex> lock(recorderMutex_);
+  recorder_ = std::move(recorder);
+}
+
+void MessageSource::recorded(const std::vector<char> & buffer, size_t size)
+{
+  std::lock_guard<std::mutex> lock(recorderMutex_);
+  if(recorder_)
+  {
+    auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch());
+    if(!recorder_->write(time.count(), buffer.data(), size))
+    {
+      mc_rtc::log::error("Failed to write a GUI message to the recording, the recording is stopped: {}",
+                         std::strerror(errno));
+      recorder_.reset();
+    }
+  }
+}
+
+void MessageSource::start()
+{
+  running_ = true;
+  thread_ = std::thread([this]() { run(); });
+}
+
+void MessageSource::stop()
+{
+  running_ = false;
+  if(thread_.joinable())
+  {
+    thread_.join();
+  }
+}
+
+void MessageSource::run()
+{
+  std::vector<char> buffer(65536);
+  std::vector<char> next(65536);
+  while(running_)
+  {
+    size_t size = receive(buffer, true);
+    if(size == 0)
+    {
+      continue;
+    }
+    received_++;
+    recorded(buffer, size);
+    // Skip to the latest pending message, a source may always have one pending so stopping is checked here too
+    while(running_)
+    {
+      size_t nextSize = receive(next, false);
+      if(nextSize == 0)
+      {
+        break;
+      }
+      received_++;
+      recorded(next, nextSize);
+      std::swap(buffer, next);
+      size = nextSize;
+    }
+    MC_RTC_BLENDER_TRACE("client/decode");
+    auto start = std::chrono::steady_clock::now();
+    auto & out = states_.back();
+    try
+    {
+      out.state = mc_rtc::Configuration::fromMessagePack(buffer.data(), size);
+    }
+    catch(const std::exception & exc)
+    {
+      mc_rtc::log::warning("Failed to decode a GUI message: {}", exc.what());
+      continue;
+    }
+    std::chrono::duration<double, std::milli> dt = std::chrono::steady_clock::now() - start;
+    out.decodeMs = dt.count();
+    states_.publish();
+  }
+}
+
+SubscriberSource::SubscriberSource(int socket) : socket_(socket)
+{
+  size_t size = sizeof(previousTimeout_);
+  if(socket_ < 0 || nn_getsockopt(socket_, NN_SOL_SOCKET, NN_RCVTIMEO, &previousTimeout_, &size) < 0)
+  {
+    throw std::runtime_error("The client is not connected to a controller");
+  }
+  // The client receives without waiting so this timeout only affects the background thread
+  int timeout = 50;
+  nn_setsockopt(socket_, NN_SOL_SOCKET, NN_RCVTIMEO, &timeout, sizeof(timeout));
+  start();
+}
+
+SubscriberSource::~SubscriberSource()
+{
+  stop();
+  nn_setsockopt(socket_, NN_SOL_SOCKET, NN_RCVTIMEO, &previousTimeout_, sizeof(previousTimeout_));
+}
+
+size_t SubscriberSource::receive(std::vector<char> & buffer, bool wait)
+{
+  void * msg = nullptr;
+  int size = nn_recv(socket_, &msg, NN_MSG, wait ? 0 : NN_DONTWAIT);
+  if(size < 0)
+  {
+    return 0;
+  }
+  if(buffer.size() < static_cast<size_t>(size))
+  {
+    buffer.resize(static_cast<size_t>(size));
+  }
+  std::memcpy(buffer.data(), msg, static_cast<size_t>(size));
+  nn_freemsg(msg);
+  return static_cast<size_t>(size);
+}
+
+ReplaySource::ReplaySource(std::shared_ptr<const Recording> recording, double speed, bool loop)
+: recording_(std::move(recording)), speed_(std::max(speed, 0.0)), loop_(loop), start_(clock::now())
+{
+  start();
+}
+
+ReplaySource::~ReplaySource()
+{
+  stop();
+}
+
+size_t ReplaySource::receive(std::vector<char> & buffer, bool wait)
+{
+  using namespace std::chrono_literals;
+  const auto & recording = *recording_;
+  if(next_ == recording.size())
+  {
+    if(!loop_ || recording.size() == 0)
+    {
+      if(wait)
+      {
+        // Waiting means the last message was decoded and published
+        finished_.store(true, std::memory_order_release);
+        std::this_thread::sleep_for(50ms);
+      }
+      return 0;
+    }
+    if(!wait)
+    {
+      // A replay as fast as possible always has a message pending, the end of the recording publishes the latest one
+      return 0;
+    }
+    next_ = 0;
+    start_ = clock::now();
+  }
+  const auto & msg = recording[next_];
+  if(speed_ > 0)
+  {
+    auto due = start_ + std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(msg.time) / speed_));
+    auto now = clock::now();
+    if(due > now)
+    {
+      if(!wait)
+      {
+        return 0;
+      }
+      std::this_thread::sleep_for(std::min<clock::duration>(due - now, 50ms));
+      if(clock::now() < due)
+      {
+        return 0;
+      }
+    }
+  }
+  if(buffer.size() < msg.size)
+  {
+    buffer.resize(msg.size);
+  }
+  std::memcpy(buffer.data(), msg.data, msg.size);
+  next_++;
+  return msg.size;
+}
+
+} // namespace mc_rtc::blender
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "Recording.h"
+#include "TripleBuffer.h"
+
+#include <mc_rtc/Configuration.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mc_rtc::blender
+{
+
+/** Receives the GUI messages of a controller and decodes them in a background thread
+ *
+ * When several messages are pending only the latest one is decoded. The main thread takes the latest decoded state
+ * with poll(), states that were not taken before a newer one is decoded are dropped.
+ */
+struct MessageSource
+{
+  virtual ~MessageSource() = default;
+
+  MessageSource(const MessageSource &) = delete;
+  MessageSource & operator=(const MessageSource &) = delete;
+
+  /** Returns true and sets \p state to the latest decoded state if a state was decoded since the last call
+   *
+   * \param decodeMs Time (ms) spent decoding this state
+   */
+  bool poll(mc_rtc::Configuration & state, double & decodeMs);
+
+  /** Number of messages received */
+  inline uint64_t received() const noexcept
+  {
+    return received_.load(std::memory_order_relaxed);
+  }
+
+  /** Number of received messages that were not returned by poll() */
+  inline uint64_t dropped() const noexcept
+  {
+    return received() - polled_;
+  }
+
+  /** Write every received message with \p recorder, including the ones that are not decoded, nullptr stops */
+  void record(std::shared_ptr<Recorder> recorder);
+
+protected:
+  MessageSource() = default;
+
+  /** Start the thread, must be called at the end of the derived class constructor */
+  void start();
+
+  /** Stop the thread, must be called at the beginning of the derived class destructor */
+  void stop();
+
+  /** Receive a message in \p buffer, \p buffer is resized if it is too small
+   *
+   * \param wait If true, wait for a message for a short time (less than 100ms), otherwise return immediately
+   *
+   * \returns The size of the message, 0 if there is no message
+   */
+  virtual size_t receive(std::vector<char> & buffer, bool wait) = 0;
+
+private:
+  struct State
+  {
+    mc_rtc::Configuration state;
+    double decodeMs = 0;
+  };
+  TripleBuffer<State> states_;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::atomic<uint64_t> received_{0};
+  /** Number of messages returned by poll() */
+  uint64_t polled_ = 0;
+  std::mutex recorderMutex_;
+  std::shared_ptr<Recorder> recorder_;
+
+  /** Pass a received message to the recorder */
+  void recorded(const std::vector<char> & buffer, size_t size);
+
+  void run();
+};
+
+/** Receives the messages published by a controller server on the SUB socket of a ControllerClient
+ *
+ * The socket is not owned by the source, the client must not read from it or close it while the source exists
+ */
+struct SubscriberSource : public MessageSource
+{
+  /** Receive on \p socket
+   *
+   * \throws std::runtime_error if \p socket is not a valid socket
+   */
+  SubscriberSource(int socket);
+
+  ~SubscriberSource() override;
+
+protected:
+  size_t receive(std::vector<char> & buffer, bool wait) override;
+
+private:
+  int socket_;
+  /** Receive timeout of the socket before it was borrowed */
+  int previousTimeout_ = -1;
+};
+
+/** Replays a recording as if its messages were received from a controller */
+struct ReplaySource : public MessageSource
+{
+  /** Replay \p recording
+   *
+   * \param speed Replay speed relative to the recording, 0 sends the messages as fast as possible. In that case most
+   * messages are dropped since only the latest one is decoded, use BlenderClient::handle_message on every message of
+   * the Recording to process all of them.
+   *
+   * \param loop Start again at the end of the recording
+   */
+  ReplaySource(std::shared_ptr<const Recording> recording, double speed, bool loop);
+
+  ~ReplaySource() override;
+
+  /** True once every message was sent and decoded, never true when looping */
+  inline bool finished() const noexcept
+  {
+    return finished_.load(std::memory_order_acquire);
+  }
+
+protected:
+  size_t receive(std::vector<char> & buffer, bool wait) override;
+
+private:
+  using clock = std::chrono::steady_clock;
+  std::shared_ptr<const Recording> recording_;
+  double speed_;
+  bool loop_;
+  /** Index of the next message */
+  size_t next_ = 0;
+  /** Time when the first message was (or will be) sent */
+  clock::time_point start_;
+  std::atomic<bool> finished_{false};
+};
+
+} // namespace mc_rtc::blender
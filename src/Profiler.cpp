@@ -0,0 +1,112 @@
+#include "Profiler.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace mc_rtc::blender
+{
+
+Profiler & Profiler::get()
+{
+  static Profiler profiler;
+  return profiler;
+}
+
+size_t Profiler::section(const std::string & name)
+{
+  auto it = ids_.find(name);
+  if(it != ids_.end())
+  {
+    return it->second;
+  }
+  size_t id = names_.size();
+  names_.push_back(name);
+  traceNames_.push_back(Tracer::intern(name));
+  ids_[name] = id;
+  current_.push_back(0.0);
+  history_.emplace_back(HISTORY, 0.0f);
+  return id;
+}
+
+void Profiler::end_frame()
+{
+  size_t idx = frames_ % HISTORY;
+  for(size_t i = 0; i < current_.size(); ++i)
+  {
+    history_[i][idx] = static_cast<float>(current_[i]);
+    current_[i] = 0.0;
+  }
+  frames_++;
+}
+
+void Profiler::reset()
+{
+  frames_ = 0;
+  std::fill(current_.begin(), current_.end(), 0.0);
+}
+
+std::vector<float> Profiler::samples(size_t section) const
+{
+  const auto & h = history_.at(section);
+  size_t n = frames();
+  std::vector<float> out(n);
+  // The oldest frame is the one that will be overwritten next
+  size_t start = (frames_ - n) % HISTORY;
+  for(size_t i = 0; i < n; ++i)
+  {
+    out[i] = h[(start + i) % HISTORY];
+  }
+  return out;
+}
+
+void Profiler::draw_window(bool * open)
+{
+  if(!ImGui::Begin("Performance", open))
+  {
+    ImGui::End();
+    return;
+  }
+  ImGui::Text("Last %zu frames, times in ms", frames());
+  ImGui::SameLine();
+  ImGui::Checkbox("Enabled", &enabled);
+  ImGui::SameLine();
+  if(ImGui::Button("Reset"))
+  {
+    reset();
+  }
+  constexpr ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit;
+  if(frames() && ImGui::BeginTable("Sections", 6, flags))
+  {
+    ImGui::TableSetupColumn("Section");
+    for(const char * c : {"mean", "p50", "p90", "p99", "max"})
+    {
+      ImGui::TableSetupColumn(c);
+    }
+    ImGui::TableHeadersRow();
+    auto percentile = [](std::vector<float> & values, double p) {
+      auto nth = values.begin() + static_cast<std::ptrdiff_t>(p * static_cast<double>(values.size() - 1));
+      std::nth_element(values.begin(), nth, values.end());
+      return *nth;
+    };
+    for(size_t i = 0; i < names_.size(); ++i)
+    {
+      auto values = samples(i);
+      float mean = std::accumulate(values.begin(), values.end(), 0.0f) / static_cast<float>(values.size());
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(names_[i].c_str());
+      for(float v : {mean, percentile(values, 0.5), percentile(values, 0.9), percentile(values, 0.99),
+                     *std::max_element(values.begin(), values.end())})
+      {
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", v);
+      }
+    }
+    ImGui::EndTable();
+  }
+  ImGui::End();
+}
+
+} // namespace mc_rtc::blender
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Tracer.h"
+
+namespace mc_rtc::blender
+{
+
+/** Records the time spent in named sections of the code during the last frames
+ *
+ * The time spent in a section is accumulated during a frame and stored in a ring buffer when the frame ends.
+ *
+ * This must only be used from the main thread. Sections are also recorded by the Tracer when it is running.
+ */
+struct Profiler
+{
+  /** Number of frames kept for each section */
+  static constexpr size_t HISTORY = 600;
+
+  /** The profiler used by the module */
+  static Profiler & get();
+
+  /** If false, sections are not timed */
+  bool enabled = true;
+
+  /** Returns the index of the section \p name, the section is created if needed */
+  size_t section(const std::string & name);
+
+  /** Add \p ms milliseconds to \p section in the current frame */
+  inline void add(size_t section, double ms) noexcept
+  {
+    current_[section] += ms;
+  }
+
+  /** Store the time spent in every section during the current frame and start a new frame */
+  void end_frame();
+
+  /** Forget every recorded frame */
+  void reset();
+
+  /** Names of the sections, indexed by section */
+  inline const std::vector<std::string> & sections() const noexcept
+  {
+    return names_;
+  }
+
+  /** Name of \p section in the Tracer */
+  inline const char * trace_name(size_t section) const noexcept
+  {
+    return traceNames_[section];
+  }
+
+  /** Number of frames available in the history */
+  inline size_t frames() const noexcept
+  {
+    return std::min(frames_, HISTORY);
+  }
+
+  /** Time (ms) spent in \p section during the last frames(), oldest first */
+  std::vector<float> samples(size_t section) const;
+
+  /** Draw an ImGui window with statistics about every section */
+  void draw_window(bool * open = nullptr);
+
+private:
+  std::vector<std::string> names_;
+  std::vector<const char *> traceNames_;
+  std::unordered_map<std::string, size_t> ids_;
+  /** Time spent in each section during the current frame */
+  std::vector<double> current_;
+  /** Ring buffers of HISTORY values */
+  std::vector<std::vector<float>> history_;
+  /** Number of frames ended since the last reset */
+  size_t frames_ = 0;
+};
+
+/** Adds the time spent between its construction and its destruction to a section of the Profiler and traces it */
+struct ProfilerScope
+{
+  ProfilerScope(size_t section)
+  : section_(section), enabled_(Profiler::get().enabled), trace_(Profiler::get().trace_name(section))
+  {
+    if(enabled_)
+    {
+      start_ = clock::now();
+    }
+  }
+
+  ~ProfilerScope()
+  {
+    if(enabled_)
+    {
+      std::chrono::duration<double, std::milli> dt = clock::now() - start_;
+      Profiler::get().add(section_, dt.count());
+    }
+  }
+
+  ProfilerScope(const ProfilerScope &) = delete;
+  ProfilerScope & operator=(const ProfilerScope &) = delete;
+
+private:
+  using clock = std::chrono::steady_clock;
+  size_t section_;
+  bool enabled_;
+  clock::time_point start_;
+  TraceScope trace_;
+};
+
+} // namespace mc_rtc::blender
+
+#define MC_RTC_BLENDER_PROFILE_CONCAT_(a, b) a##b
+#define MC_RTC_BLENDER_PROFILE_CONCAT(a, b) MC_RTC_BLENDER_PROFILE_CONCAT_(a, b)
+
+/** Time the rest of the enclosing scope as the section \p name of the Profiler
+ *
+ * The section is looked up once per call site so \p name must not change between calls
+ */
+#define MC_RTC_BLENDER_PROFILE(name)                                                                   \
+  static const size_t MC_RTC_BLENDER_PROFILE_CONCAT(profilerSection_, __LINE__) =                      \
+      ::mc_rtc::blender::Profiler::get().section(name);                                                \
+  ::mc_rtc::blender::ProfilerScope MC_RTC_BLENDER_PROFILE_CONCAT(profilerScope_, __LINE__)(           \
+      MC_RTC_BLENDER_PROFILE_CONCAT(profilerSection_, __LINE__))
@@ -0,0 +1,113 @@
+#include "Recording.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace mc_rtc::blender
+{
+
+namespace
+{
+
+constexpr size_t HEADER_SIZE = 16;
+constexpr size_t RECORD_HEADER_SIZE = 16;
+
+inline size_t padded(size_t size) noexcept
+{
+  return (size + 7) & ~size_t(7);
+}
+
+} // namespace
+
+Recorder::Recorder(const std::string & path) : file_(std::fopen(path.c_str(), "wb"))
+{
+  if(!file_)
+  {
+    throw std::runtime_error("Cannot create the recording " + path);
+  }
+  char header[HEADER_SIZE] = {};
+  std::memcpy(header, MAGIC, sizeof(MAGIC));
+  std::memcpy(header + sizeof(MAGIC), &VERSION, sizeof(VERSION));
+  if(std::fwrite(header, 1, HEADER_SIZE, file_) != HEADER_SIZE || std::fflush(file_) != 0)
+  {
+    std::fclose(file_);
+    throw std::runtime_error("Cannot write the recording " + path);
+  }
+}
+
+Recorder::~Recorder()
+{
+  std::fclose(file_);
+}
+
+bool Recorder::write(int64_t time, const char * data, size_t size)
+{
+  if(failed())
+  {
+    return false;
+  }
+  static const char zeros[8] = {};
+  uint64_t size64 = size;
+  char header[RECORD_HEADER_SIZE];
+  std::memcpy(header, &time, 8);
+  std::memcpy(header + 8, &size64, 8);
+  size_t padding = padded(size) - size;
+  // Messages arrive at a low rate, flushing each of them keeps the file readable at any time
+  if(std::fwrite(header, 1, RECORD_HEADER_SIZE, file_) != RECORD_HEADER_SIZE
+     || std::fwrite(data, 1, size, file_) != size || std::fwrite(zeros, 1, padding, file_) != padding
+     || std::fflush(file_) != 0)
+  {
+    failed_ = true;
+    return false;
+  }
+  messages_++;
+  return true;
+}
+
+Recording::Recording(const std::string & path)
+{
+  namespace bip = boost::interprocess;
+  try
+  {
+    file_ = bip::file_mapping(path.c_str(), bip::read_only);
+    region_ = bip::mapped_region(file_, bip::read_only);
+  }
+  catch(const bip::interprocess_exception & exc)
+  {
+    throw std::runtime_error("Cannot open the recording " + path + ": " + exc.what());
+  }
+  const char * data = static_cast<const char *>(region_.get_address());
+  size_t size = region_.get_size();
+  uint32_t version = 0;
+  if(size >= HEADER_SIZE)
+  {
+    std::memcpy(&version, data + sizeof(Recorder::MAGIC), sizeof(version));
+  }
+  if(size < HEADER_SIZE || std::memcmp(data, Recorder::MAGIC, sizeof(Recorder::MAGIC)) != 0
+     || version != Recorder::VERSION)
+  {
+    throw std::runtime_error(path + " is not a GUI recording");
+  }
+  size_t offset = HEADER_SIZE;
+  int64_t start = 0;
+  while(offset + RECORD_HEADER_SIZE <= size)
+  {
+    int64_t time;
+    uint64_t msgSize;
+    std::memcpy(&time, data + offset, 8);
+    std::memcpy(&msgSize, data + offset + 8, 8);
+    offset += RECORD_HEADER_SIZE;
+    if(msgSize > size - offset)
+    {
+      break;
+    }
+    if(messages_.empty())
+    {
+      start = time;
+    }
+    messages_.push_back({time - start, data + offset, static_cast<size_t>(msgSize)});
+    offset += padded(static_cast<size_t>(msgSize));
+  }
+}
+
+} // namespace mc_rtc::blender
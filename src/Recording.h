@@ -0,0 +1,101 @@
+#pragma once
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace mc_rtc::blender
+{
+
+/** Writes GUI messages and their reception time to a file
+ *
+ * The file starts with a 16 bytes header (MAGIC then the format version), then every message is stored as its
+ * reception time in nanoseconds (int64), its size (uint64) and its content padded with zeros to a multiple of 8 bytes.
+ * The file is only appended to so an interrupted recording can still be read.
+ */
+struct Recorder
+{
+  static constexpr char MAGIC[8] = {'M', 'C', 'R', 'T', 'C', 'G', 'U', 'I'};
+  static constexpr uint32_t VERSION = 1;
+
+  /** Create or truncate \p path
+   *
+   * \throws std::runtime_error if the file cannot be created
+   */
+  Recorder(const std::string & path);
+
+  ~Recorder();
+
+  Recorder(const Recorder &) = delete;
+  Recorder & operator=(const Recorder &) = delete;
+
+  /** Append a message received at \p time (nanoseconds, any origin)
+   *
+   * \returns False if the message could not be written, the recorder has failed() and ignores new messages
+   */
+  bool write(int64_t time, const char * data, size_t size);
+
+  /** Number of messages written */
+  inline uint64_t messages() const noexcept
+  {
+    return messages_.load(std::memory_order_relaxed);
+  }
+
+  /** True if a write failed, the file ends with the last message written successfully or a truncated one */
+  inline bool failed() const noexcept
+  {
+    return failed_.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::FILE * file_;
+  std::atomic<uint64_t> messages_{0};
+  std::atomic<bool> failed_{false};
+};
+
+/** Read-only view of a file written by Recorder, the file is memory-mapped */
+struct Recording
+{
+  struct Message
+  {
+    /** Reception time in nanoseconds since the first message */
+    int64_t time;
+    const char * data;
+    size_t size;
+  };
+
+  /** Open \p path, a truncated last message is ignored
+   *
+   * \throws std::runtime_error if the file cannot be read or is not a recording
+   */
+  Recording(const std::string & path);
+
+  /** Number of messages */
+  inline size_t size() const noexcept
+  {
+    return messages_.size();
+  }
+
+  inline const Message & operator[](size_t i) const noexcept
+  {
+    return messages_[i];
+  }
+
+  /** Time between the first and the last message in nanoseconds */
+  inline int64_t duration() const noexcept
+  {
+    return messages_.size() ? messages_.back().time : 0;
+  }
+
+private:
+  boost::interprocess::file_mapping file_;
+  boost::interprocess::mapped_region region_;
+  std::vector<Message> messages_;
+};
+
+} // namespace mc_rtc::blender
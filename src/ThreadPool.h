@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace mc_rtc::blender
+{
+
+/** A fixed number of threads running submitted tasks in order */
+struct ThreadPool
+{
+  /** Start \p size threads, defaults to one per hardware thread */
+  explicit ThreadPool(size_t size = std::max(std::thread::hardware_concurrency(), 1u))
+  {
+    for(size_t i = 0; i < size; ++i)
+    {
+      workers_.emplace_back([this]() { work(); });
+    }
+  }
+
+  /** Finish the queued tasks and join the threads */
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for(auto & w : workers_)
+    {
+      w.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool & operator=(const ThreadPool &) = delete;
+
+  /** Run \p f on one of the threads, the returned future holds its result or the exception it threw */
+  template<typename F>
+  std::future<std::invoke_result_t<F>> submit(F && f)
+  {
+    auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(f));
+    auto out = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.emplace([task]() { (*task)(); });
+    }
+    cv_.notify_one();
+    return out;
+  }
+
+  /** Pool shared by the whole module */
+  static ThreadPool & global()
+  {
+    static ThreadPool pool;
+    return pool;
+  }
+
+private:
+  std::vector<std::thread> workers_;
+  std::queue<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+
+  void work()
+  {
+    while(true)
+    {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+        if(tasks_.empty())
+        {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop();
+      }
+      task();
+    }
+  }
+};
+
+} // namespace mc_rtc::blender
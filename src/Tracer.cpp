@@ -0,0 +1,186 @@
+#include "Tracer.h"
+
+#include <mc_rtc/logging.h>
+
+#include <fstream>
+#include <unordered_set>
+
+namespace mc_rtc::blender
+{
+
+namespace
+{
+
+/** Write \p s as a JSON string */
+void writeString(std::ostream & os, const char * s)
+{
+  os << '"';
+  for(; *s; ++s)
+  {
+    if(*s == '"' || *s == '\\')
+    {
+      os << '\\';
+    }
+    os << *s;
+  }
+  os << '"';
+}
+
+} // namespace
+
+Tracer & Tracer::get()
+{
+  static Tracer tracer;
+  return tracer;
+}
+
+void Tracer::start()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  origin_ = now();
+  generation_.fetch_add(1, std::memory_order_release);
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::stop()
+{
+  enabled_.store(false, std::memory_order_relaxed);
+}
+
+struct Tracer::ThreadBuffer
+{
+  Buffer * buffer = Tracer::get().acquire_buffer();
+
+  ~ThreadBuffer()
+  {
+    Tracer::get().release_buffer(buffer);
+  }
+};
+
+Tracer::Buffer * Tracer::acquire_buffer()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if(free_.size())
+  {
+    // The events of the previous thread stay on the same trace row, the threads did not run at the same time
+    auto * buffer = free_.back();
+    free_.pop_back();
+    return buffer;
+  }
+  buffers_.push_back(std::make_unique<Buffer>(buffers_.size() + 1));
+  return buffers_.back().get();
+}
+
+void Tracer::release_buffer(Buffer * buffer)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_.push_back(buffer);
+}
+
+void Tracer::record(const char * name, int64_t start, int64_t end)
+{
+  auto & tracer = get();
+  thread_local ThreadBuffer local;
+  auto * buffer = local.buffer;
+  if(buffer->generation.load(std::memory_order_relaxed) != tracer.generation_.load(std::memory_order_acquire))
+  {
+    // This only happens once per start(), the lock keeps dump() from reading the buffer while it is cleared
+    std::lock_guard<std::mutex> lock(tracer.mutex_);
+    buffer->size.store(0, std::memory_order_relaxed);
+    buffer->dropped.store(0, std::memory_order_relaxed);
+    buffer->generation.store(tracer.generation_.load(std::memory_order_relaxed), std::memory_order_release);
+  }
+  size_t size = buffer->size.load(std::memory_order_relaxed);
+  if(size == CAPACITY)
+  {
+    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer->events[size] = {name, start, end};
+  buffer->size.store(size + 1, std::memory_order_release);
+}
+
+const char * Tracer::intern(const std::string & name)
+{
+  static std::mutex mutex;
+  static std::unordered_set<std::string> names;
+  std::lock_guard<std::mutex> lock(mutex);
+  return names.insert(name).first->c_str();
+}
+
+size_t Tracer::events() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t generation = generation_.load(std::memory_order_acquire);
+  size_t out = 0;
+  for(const auto & b : buffers_)
+  {
+    if(b->generation.load(std::memory_order_acquire) == generation)
+    {
+      out += b->size.load(std::memory_order_acquire);
+    }
+  }
+  return out;
+}
+
+size_t Tracer::dropped() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t generation = generation_.load(std::memory_order_acquire);
+  size_t out = 0;
+  for(const auto & b : buffers_)
+  {
+    if(b->generation.load(std::memory_order_acquire) == generation)
+    {
+      out += b->dropped.load(std::memory_order_relaxed);
+    }
+  }
+  return out;
+}
+
+bool Tracer::dump(const std::string & path) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::ofstream ofs(path);
+  if(!ofs)
+  {
+    mc_rtc::log::error("Failed to open the trace file {}", path);
+    return false;
+  }
+  uint64_t generation = generation_.load(std::memory_order_acquire);
+  ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  ofs.setf(std::ios::fixed);
+  ofs.precision(3);
+  bool first = true;
+  for(const auto & b : buffers_)
+  {
+    if(b->generation.load(std::memory_order_acquire) != generation)
+    {
+      continue;
+    }
+    size_t size = b->size.load(std::memory_order_acquire);
+    for(size_t i = 0; i < size; ++i)
+    {
+      const auto & e = b->events[i];
+      // The category is the prefix of the name, e.g. interface for interface/load_mesh
+      std::string name = e.name;
+      std::string category = name.substr(0, name.find('/'));
+      ofs << (first ? "\n" : ",\n") << "{\"name\":";
+      writeString(ofs, name.c_str());
+      ofs << ",\"cat\":";
+      writeString(ofs, category.c_str());
+      ofs << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << b->tid << ",\"ts\":" << static_cast<double>(e.start - origin_) / 1e3
+          << ",\"dur\":" << static_cast<double>(e.end - e.start) / 1e3 << "}";
+      first = false;
+    }
+  }
+  ofs << "\n]}\n";
+  if(!ofs)
+  {
+    mc_rtc::log::error("Failed to write the trace file {}", path);
+    return false;
+  }
+  return true;
+}
+
+} // namespace mc_rtc::blender
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mc_rtc::blender
+{
+
+/** Records timed events from every thread and writes them as a Chrome trace
+ *
+ * Each thread writes its events to its own fixed-size buffer without locking, events recorded when that buffer is
+ * full are dropped. The buffer of a thread that exits is reused by the next thread that records an event, its events
+ * are kept until then. Tracing is off by default, then an event only costs a relaxed atomic load.
+ */
+struct Tracer
+{
+  /** Maximum number of events recorded by a thread between two start() calls */
+  static constexpr size_t CAPACITY = 1 << 16;
+
+  /** The tracer used by the module */
+  static Tracer & get();
+
+  /** True while events are recorded */
+  static inline bool enabled() noexcept
+  {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  /** Forget the recorded events and start recording */
+  void start();
+
+  /** Stop recording, the events are kept until the next start() */
+  void stop();
+
+  /** Current time in nanoseconds */
+  static inline int64_t now() noexcept
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count();
+  }
+
+  /** Record an event of the calling thread, \p name must live as long as the program */
+  static void record(const char * name, int64_t start, int64_t end);
+
+  /** Returns a copy of \p name that lives as long as the program */
+  static const char * intern(const std::string & name);
+
+  /** Number of events recorded since the last start() */
+  size_t events() const;
+
+  /** Number of events dropped since the last start() */
+  size_t dropped() const;
+
+  /** Write the events recorded since the last start() in the Chrome trace JSON format
+   *
+   * The file can be opened with chrome://tracing or https://ui.perfetto.dev
+   *
+   * \returns False if the file could not be written
+   */
+  bool dump(const std::string & path) const;
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  struct Event
+  {
+    const char * name;
+    int64_t start;
+    int64_t end;
+  };
+
+  /** Events of a thread, only written by this thread, cleared by this thread while holding Tracer::mutex_ */
+  struct Buffer
+  {
+    Buffer(size_t tid) : tid(tid), events(CAPACITY) {}
+    size_t tid;
+    std::vector<Event> events;
+    /** Events up to size are complete */
+    std::atomic<size_t> size{0};
+    std::atomic<size_t> dropped{0};
+    /** Value of Tracer::generation_ when the buffer was last cleared */
+    std::atomic<uint64_t> generation{0};
+  };
+
+  static inline std::atomic<bool> enabled_{false};
+  /** Incremented by start(), buffers of older generations are cleared by their thread on the next event */
+  std::atomic<uint64_t> generation_{0};
+  /** Time of the last start() */
+  int64_t origin_ = 0;
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+  /** Buffers of the threads that exited */
+  std::vector<Buffer *> free_;
+
+  /** Owns the buffer of a thread and releases it when the thread exits */
+  struct ThreadBuffer;
+
+  /** Reuse a buffer released by an exited thread or create one */
+  Buffer * acquire_buffer();
+
+  /** Make \p buffer available to other threads */
+  void release_buffer(Buffer * buffer);
+};
+
+/** Records an event of the Tracer lasting from its construction to its destruction */
+struct TraceScope
+{
+  TraceScope(const char * name) noexcept : name_(Tracer::enabled() ? name : nullptr), start_(name_ ? Tracer::now() : 0)
+  {
+  }
+
+  ~TraceScope()
+  {
+    if(name_)
+    {
+      Tracer::record(name_, start_, Tracer::now());
+    }
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope & operator=(const TraceScope &) = delete;
+
+private:
+  const char * name_;
+  int64_t start_;
+};
+
+} // namespace mc_rtc::blender
+
+#define MC_RTC_BLENDER_TRACE_CONCAT_(a, b) a##b
+#define MC_RTC_BLENDER_TRACE_CONCAT(a, b) MC_RTC_BLENDER_TRACE_CONCAT_(a, b)
+
+/** Trace the rest of the enclosing scope as the event \p name, \p name must be a string literal */
+#define MC_RTC_BLENDER_TRACE(name) \
+  ::mc_rtc::blender::TraceScope MC_RTC_BLENDER_TRACE_CONCAT(traceScope_, __LINE__)(name)
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace mc_rtc::blender
+{
+
+/** Hands the latest value produced by a writer thread to a reader thread without locks
+ *
+ * The writer fills back() then calls publish(). The reader calls update() to get the latest published value in
+ * front(), values published in between are dropped. Neither side ever waits for the other.
+ */
+template<typename T>
+struct TripleBuffer
+{
+  /** Value being written, only used by the writer */
+  inline T & back() noexcept
+  {
+    return buffers_[back_];
+  }
+
+  /** Make back() the latest value, the writer gets a new back() */
+  inline void publish() noexcept
+  {
+    back_ = state_.exchange(back_ | NEW, std::memory_order_acq_rel) & INDEX;
+  }
+
+  /** Returns true if a value was published since the last call, front() is then the latest value */
+  inline bool update() noexcept
+  {
+    if(!(state_.load(std::memory_order_relaxed) & NEW))
+    {
+      return false;
+    }
+    front_ = state_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+    return true;
+  }
+
+  /** Latest value obtained by update(), only used by the reader */
+  inline T & front() noexcept
+  {
+    return buffers_[front_];
+  }
+
+private:
+  static constexpr uint8_t INDEX = 3;
+  static constexpr uint8_t NEW = 4;
+  std::array<T, 3> buffers_;
+  uint8_t back_ = 0;
+  /** Index of the buffer between the writer and the reader, with the NEW flag if it was not read yet */
+  std::atomic<uint8_t> state_{1};
+  uint8_t front_ = 2;
+};
+
+} // namespace mc_rtc::blender
@@ -9,6 +9,12 @@
 #include <imgui_internal.h>
 
 #include "BlenderClient.h"
+#include "DrawData.h"
+#include "FontAtlas.h"
+#include "MeshLoader.h"
+#include "MeshRegistry.h"
+#include "Profiler.h"
+#include "widgets/Robot.h"
 
 namespace py = pybind11;
 
@@ -30,72 +36,192 @@ struct ImDrawListProxy
   }
 };
 
+/** Call a Python override of a pure virtual Interface3D method
+ *
+ * This is used instead of PYBIND11_OVERRIDE_PURE when an argument is better passed as a numpy array than through the
+ * default conversion
+ */
+template<typename... Args>
+void call_override(const Interface3D * self, const char * name, Args &&... args)
+{
+  py::gil_scoped_acquire gil;
+  py::function override = py::get_override(self, name);
+  if(!override)
+  {
+    py::pybind11_fail(fmt::format("Tried to call pure virtual function \"Interface3D::{}\"", name));
+  }
+  override(std::forward<Args>(args)...);
+}
+
+/** Read-only view of \p data with the given \p strides (in bytes), the array keeps \p base alive */
+template<typename T>
+py::array readonly_view(py::handle base,
+                        const T * data,
+                        std::vector<py::ssize_t> shape,
+                        std::vector<py::ssize_t> strides)
+{
+  py::array_t<T> out(std::move(shape), std::move(strides), data, base);
+  py::detail::array_proxy(out.ptr())->flags &= ~py::detail::npy_api::NPY_ARRAY_WRITEABLE_;
+  return out;
+}
+
+/** Read-only view of contiguous \p data, the array keeps \p base alive */
+template<typename T>
+py::array readonly_view(py::handle base, const T * data, std::vector<py::ssize_t> shape)
+{
+  std::vector<py::ssize_t> strides(shape.size(), sizeof(T));
+  for(size_t i = shape.size(); i-- > 1;)
+  {
+    strides[i - 1] = strides[i] * shape[i];
+  }
+  return readonly_view(base, data, std::move(shape), std::move(strides));
+}
+
+/** Read-only (N, \p cols) view of a field of the ImDrawVert in \p list, no copy is made
+ *
+ * The view is only valid for the current frame, see the ImDrawList binding
+ */
+template<typename T>
+py::array vertex_view(py::object list, size_t offset, py::ssize_t cols)
+{
+  const auto & vtx = list.cast<const ImDrawList &>().VtxBuffer;
+  const auto * data = reinterpret_cast<const T *>(reinterpret_cast<const char *>(vtx.Data) + offset);
+  return readonly_view(list, data, {vtx.Size, cols}, {sizeof(ImDrawVert), sizeof(T)});
+}
+
+/** Read-only view of \p data, the array keeps \p owner alive */
+template<typename T>
+py::array readonly_view(std::shared_ptr<const void> owner, const T * data, std::vector<py::ssize_t> shape)
+{
+  using holder_t = std::shared_ptr<const void>;
+  py::capsule base(new holder_t(std::move(owner)), [](void * h) { delete static_cast<holder_t *>(h); });
+  return readonly_view(base, data, std::move(shape));
+}
+
+/** Read-only view of a member of \p self with \p cols values per row, valid until the member is modified */
+template<typename T>
+py::array member_view(py::handle self, const std::vector<T> & data, py::ssize_t cols)
+{
+  py::ssize_t rows = static_cast<py::ssize_t>(data.size()) / cols;
+  if(cols == 1)
+  {
+    return readonly_view(self, data.data(), {rows});
+  }
+  return readonly_view(self, data.data(), {rows, cols});
+}
+
+/** Read-only (N, 7) view of poses stored as in MeshBatch, the array keeps the buffer alive */
+py::array pose_view(std::shared_ptr<const std::vector<float>> poses)
+{
+  if(!poses)
+  {
+    poses = std::make_shared<const std::vector<float>>();
+  }
+  py::ssize_t n = static_cast<py::ssize_t>(poses->size() / MeshBatch::POSE_SIZE);
+  return readonly_view(poses, poses->data(), {n, MeshBatch::POSE_SIZE});
+}
+
+mc_rtc::blender::Robot & get_robot(mc_rtc::blender::BlenderClient & client, const std::string & name)
+{
+  const auto & robots = client.robots();
+  auto it = robots.find(name);
+  if(it == robots.end())
+  {
+    throw py::key_error(fmt::format("No robot named {} in the client", name));
+  }
+  return *it->second;
+}
+
 struct BlenderInterface : public Interface3D
 {
   ~BlenderInterface() override = default;
 
-  std::string add_collection(const std::vector<std::string> & category, const std::string & name) override
+  void add_collection(Handle collection, const std::vector<std::string> & category, const std::string & name) override
+  {
+    MC_RTC_BLENDER_PROFILE("interface/add_collection");
+    PYBIND11_OVERRIDE_PURE(void, Interface3D, add_collection, collection, category, name);
+  }
+
+  void hide_collection(Handle collection, bool hide) override
   {
-    PYBIND11_OVERRIDE_PURE(std::string, Interface3D, add_collection, category, name);
+    MC_RTC_BLENDER_PROFILE("interface/hide_collection");
+    PYBIND11_OVERRIDE_PURE(void, Interface3D, hide_collection, collection, hide);
   }
 
-  void hide_collection(const std::string & name, bool hide) override
+  void remove_collection(Handle collection) override
   {
-    PYBIND11_OVERRIDE_PURE(void, Interface3D, hide_collection, name, hide);
+    MC_RTC_BLENDER_PROFILE("interface/remove_collection");
+    PYBIND11_OVERRIDE_PURE(void, Interface3D, remove_collection, collection);
   }
 
-  void remove_collection(const std::string & name) override
+  void load_mesh(Handle mesh,
+                 Handle collection,
+                 const std::string & meshPath,
+                 const std::string & meshName,
+                 const std::array<double, 4> & defaultColor,
+                 const std::shared_ptr<const mc_rtc::blender::MeshData> & data) override
   {
-    PYBIND11_OVERRIDE_PURE(void, Interface3D, remove_collection, name);
+    MC_RTC_BLENDER_PROFILE("interface/load_mesh");
+    // The data is exposed through read-only arrays
+    auto pyData = std::const_pointer_cast<mc_rtc::blender::MeshData>(data);
+    call_override(this, "load_mesh", mesh, collection, meshPath, meshName, defaultColor, pyData);
   }
 
-  std::string load_mesh(const std::string & collection,
-                        const std::string & meshPath,
-                        const std::string & meshName,
-                        const std::array<double, 4> & defaultColor) override
+  void set_mesh_position(Handle mesh, const sva::PTransformd & pose) override
   {
-    PYBIND11_OVERRIDE_PURE(std::string, Interface3D, load_mesh, collection, meshPath, meshName, defaultColor);
+    MC_RTC_BLENDER_PROFILE("interface/set_mesh_position");
+    PYBIND11_OVERRIDE_PURE(void, Interface3D, set_mesh_position, mesh, pose);
   }
 
-  void set_mesh_position(const std::string & meshName, const sva::PTransformd & pose) override
+  void set_mesh_positions(const std::vector<Handle> & meshes, const std::vector<float> & poses) override
   {
-    PYBIND11_OVERRIDE_PURE(void, Interface3D, set_mesh_position, meshName, pose);
+    MC_RTC_BLENDER_PROFILE("interface/set_mesh_positions");
+    py::array_t<Handle> handles(meshes.size(), meshes.data());
+    py::array_t<float> array({meshes.size(), MeshBatch::POSE_SIZE}, poses.data());
+    call_override(this, "set_mesh_positions", handles, array);
   }
 
-  void remove_mesh(const std::string & meshName) override
+  void remove_mesh(Handle mesh) override
   {
-    PYBIND11_OVERRIDE_PURE(void, Interface3D, remove_mesh, meshName);
+    MC_RTC_BLENDER_PROFILE("interface/remove_mesh");
+    PYBIND11_OVERRIDE_PURE(void, Interface3D, remove_mesh, mesh);
   }
 
-  std::string add_interactive_marker(const std::vector<std::string> & category,
-                                     const std::string & name,
-                                     const mc_rtc::blender::ControlAxis & axis,
-                                     const std::function<void(const sva::PTransformd &)> & callback) override
+  void add_interactive_marker(Handle marker,
+                              const std::vector<std::string> & category,
+                              const std::string & name,
+                              const mc_rtc::blender::ControlAxis & axis,
+                              const std::function<void(const sva::PTransformd &)> & callback) override
   {
-    PYBIND11_OVERRIDE_PURE(std::string, Interface3D, add_interactive_marker, category, name, axis, callback);
+    MC_RTC_BLENDER_PROFILE("interface/add_interactive_marker");
+    PYBIND11_OVERRIDE_PURE(void, Interface3D, add_interactive_marker, marker, category, name, axis, callback);
   }
 
-  void update_interactive_marker(const std::string & name, bool ro, const sva::PTransformd & pos) override
+  void update_interactive_marker(Handle marker, bool ro, const sva::PTransformd & pos) override
   {
-    PYBIND11_OVERRIDE_PURE(void, Interface3D, update_interactive_marker, name, ro, pos);
+    MC_RTC_BLENDER_PROFILE("interface/update_interactive_marker");
+    PYBIND11_OVERRIDE_PURE(void, Interface3D, update_interactive_marker, marker, ro, pos);
   }
 
-  void set_marker_hidden(const std::string & name, bool hidden) override
+  void set_marker_hidden(Handle marker, bool hidden) override
   {
-    PYBIND11_OVERRIDE_PURE(void, Interface3D, set_marker_hidden, name, hidden);
+    MC_RTC_BLENDER_PROFILE("interface/set_marker_hidden");
+    PYBIND11_OVERRIDE_PURE(void, Interface3D, set_marker_hidden, marker, hidden);
   }
 
-  void remove_interactive_marker(const std::string & name) override
+  void remove_interactive_marker(Handle marker) override
   {
-    PYBIND11_OVERRIDE_PURE(void, Interface3D, remove_interactive_marker, name);
+    MC_RTC_BLENDER_PROFILE("interface/remove_interactive_marker");
+    PYBIND11_OVERRIDE_PURE(void, Interface3D, remove_interactive_marker, marker);
   }
 
-  std::string add_arrow(const std::vector<std::string> & category, const std::string & name) override
+  void add_arrow(Handle arrow, const std::vector<std::string> & category, const std::string & name) override
   {
-    PYBIND11_OVERRIDE_PURE(std::string, Interface3D, add_arrow, category, name);
+    MC_RTC_BLENDER_PROFILE("interface/add_arrow");
+    PYBIND11_OVERRIDE_PURE(void, Interface3D, add_arrow, arrow, category, name);
   }
 
-  void update_arrow(const std::string & name,
+  void update_arrow(Handle arrow,
                     const Eigen::Vector3d & start,
                     const Eigen::Vector3d & end,
                     double shaft_diam,
@@ -103,13 +229,70 @@ struct BlenderInterface : public Interface3D
                     double head_len,
                     const std::array<double, 4> & color) override
   {
-    PYBIND11_OVERRIDE_PURE(void, Interface3D, update_arrow, name, start, end, shaft_diam, head_diam, head_len, color);
+    MC_RTC_BLENDER_PROFILE("interface/update_arrow");
+    PYBIND11_OVERRIDE_PURE(void, Interface3D, update_arrow, arrow, start, end, shaft_diam, head_diam, head_len, color);
+  }
+
+  void remove_arrow(Handle arrow) override
+  {
+    MC_RTC_BLENDER_PROFILE("interface/remove_arrow");
+    PYBIND11_OVERRIDE_PURE(void, Interface3D, remove_arrow, arrow);
   }
 
-  void remove_arrow(const std::string & name) override
+  void add_polyline(Handle polyline, const std::vector<std::string> & category, const std::string & name) override
   {
-    PYBIND11_OVERRIDE_PURE(void, Interface3D, remove_arrow, name);
+    MC_RTC_BLENDER_PROFILE("interface/add_polyline");
+    PYBIND11_OVERRIDE_PURE(void, Interface3D, add_polyline, polyline, category, name);
   }
+
+  void set_polyline_style(Handle polyline, const std::array<double, 4> & color, double width) override
+  {
+    MC_RTC_BLENDER_PROFILE("interface/set_polyline_style");
+    PYBIND11_OVERRIDE_PURE(void, Interface3D, set_polyline_style, polyline, color, width);
+  }
+
+  void set_polyline(Handle polyline, const std::vector<float> & points) override
+  {
+    MC_RTC_BLENDER_PROFILE("interface/set_polyline");
+    py::array_t<float> array({points.size() / 3, size_t(3)}, points.data());
+    call_override(this, "set_polyline", polyline, array);
+  }
+
+  void append_polyline(Handle polyline, const std::vector<float> & points) override
+  {
+    MC_RTC_BLENDER_PROFILE("interface/append_polyline");
+    py::array_t<float> array({points.size() / 3, size_t(3)}, points.data());
+    call_override(this, "append_polyline", polyline, array);
+  }
+
+  void set_polyline_markers(Handle polyline,
+                            const Eigen::Vector3d & start,
+                            const Eigen::Vector3d & end,
+                            double size) override
+  {
+    MC_RTC_BLENDER_PROFILE("interface/set_polyline_markers");
+    PYBIND11_OVERRIDE_PURE(void, Interface3D, set_polyline_markers, polyline, start, end, size);
+  }
+
+  void set_polyline_frames(Handle polyline, const std::vector<float> & poses) override
+  {
+    MC_RTC_BLENDER_PROFILE("interface/set_polyline_frames");
+    py::array_t<float> array({poses.size() / MeshBatch::POSE_SIZE, MeshBatch::POSE_SIZE}, poses.data());
+    call_override(this, "set_polyline_frames", polyline, array);
+  }
+
+  void remove_polyline(Handle polyline) override
+  {
+    MC_RTC_BLENDER_PROFILE("interface/remove_polyline");
+    PYBIND11_OVERRIDE_PURE(void, Interface3D, remove_polyline, polyline);
+  }
+};
+
+/** Python context manager timing its body as a section of the Profiler */
+struct ProfilerSection
+{
+  size_t section;
+  std::optional<mc_rtc::blender::ProfilerScope> scope;
 };
 
 PYBIND11_MODULE(mc_rtc_blender, m)
@@ -154,14 +337,155 @@ PYBIND11_MODULE(mc_rtc_blender, m)
           "rotation", [](const sva::PTransformd & pt) { return Eigen::Quaterniond(pt.rotation()); },
           [](sva::PTransformd & pt, const Eigen::Quaterniond & q) { pt.rotation() = q.toRotationMatrix(); });
 
+  using mc_rtc::blender::MeshData;
+  py::class_<MeshData, std::shared_ptr<MeshData>>(m, "MeshData")
+      .def_property_readonly("vertices",
+                             [](const std::shared_ptr<MeshData> & self) {
+                               py::ssize_t n = static_cast<py::ssize_t>(self->vertices.size() / 3);
+                               return readonly_view(self, self->vertices.data(), {n, 3});
+                             })
+      .def_property_readonly("triangles",
+                             [](const std::shared_ptr<MeshData> & self) {
+                               py::ssize_t n = static_cast<py::ssize_t>(self->triangles.size() / 3);
+                               return readonly_view(self, self->triangles.data(), {n, 3});
+                             })
+      .def_property_readonly("triangle_materials",
+                             [](const std::shared_ptr<MeshData> & self) {
+                               py::ssize_t n = static_cast<py::ssize_t>(self->triangle_materials.size());
+                               return readonly_view(self, self->triangle_materials.data(), {n});
+                             })
+      .def_property_readonly("material_colors",
+                             [](const std::shared_ptr<MeshData> & self) {
+                               py::ssize_t n = static_cast<py::ssize_t>(self->material_colors.size() / 4);
+                               return readonly_view(self, self->material_colors.data(), {n, 4});
+                             })
+      .def_readonly("material_names", &MeshData::material_names)
+      .def_readonly("textured", &MeshData::textured);
+  m.def("load_mesh_data", &MeshData::load, py::call_guard<py::gil_scoped_release>(),
+        "Load the geometry of a STL or COLLADA file, raises RuntimeError if it fails");
+
+  py::class_<mc_rtc::blender::MeshRegistry>(m, "MeshRegistry")
+      .def(py::init<const std::string &>(), py::arg("index") = "")
+      .def("hash", &mc_rtc::blender::MeshRegistry::hash, py::call_guard<py::gil_scoped_release>(),
+           "Content hash of a file, only computed if the file changed since it was last seen, 0 if it cannot be read")
+      .def("save", &mc_rtc::blender::MeshRegistry::save)
+      .def_property_readonly("hashed_files", &mc_rtc::blender::MeshRegistry::hashed_files)
+      .def_property_readonly("cached_files", &mc_rtc::blender::MeshRegistry::cached_files);
+
+  py::class_<mc_rtc::blender::ClientSettings>(m, "ClientSettings")
+      .def_readwrite("translation_tolerance", &mc_rtc::blender::ClientSettings::translation_tolerance)
+      .def_readwrite("rotation_tolerance", &mc_rtc::blender::ClientSettings::rotation_tolerance)
+      .def_readwrite("meshes_per_frame", &mc_rtc::blender::ClientSettings::meshes_per_frame)
+      .def_readwrite("trajectory_max_points", &mc_rtc::blender::ClientSettings::trajectory_max_points)
+      .def_readwrite("trajectory_max_duration", &mc_rtc::blender::ClientSettings::trajectory_max_duration)
+      .def_readwrite("trajectory_min_distance", &mc_rtc::blender::ClientSettings::trajectory_min_distance)
+      .def_readwrite("trajectory_min_angle", &mc_rtc::blender::ClientSettings::trajectory_min_angle)
+      .def_readwrite("trajectory_lod_min_points", &mc_rtc::blender::ClientSettings::trajectory_lod_min_points)
+      .def_readwrite("trajectory_lod_tolerance", &mc_rtc::blender::ClientSettings::trajectory_lod_tolerance)
+      .def_readwrite("skip_unchanged", &mc_rtc::blender::ClientSettings::skip_unchanged)
+      .def_readwrite("background_receive", &mc_rtc::blender::ClientSettings::background_receive)
+      .def_readwrite("show_performance", &mc_rtc::blender::ClientSettings::show_performance);
+
+  py::class_<mc_rtc::blender::ClientStats>(m, "ClientStats")
+      .def_readonly("skipped_mesh_updates", &mc_rtc::blender::ClientStats::skipped_mesh_updates)
+      .def_readonly("sent_mesh_updates", &mc_rtc::blender::ClientStats::sent_mesh_updates)
+      .def_readonly("applied_updates", &mc_rtc::blender::ClientStats::applied_updates)
+      .def_readonly("skipped_updates", &mc_rtc::blender::ClientStats::skipped_updates)
+      .def_readonly("received_messages", &mc_rtc::blender::ClientStats::received_messages)
+      .def_readonly("dropped_messages", &mc_rtc::blender::ClientStats::dropped_messages)
+      .def_readonly("recorded_messages", &mc_rtc::blender::ClientStats::recorded_messages);
+
+  using mc_rtc::blender::Profiler;
+  py::class_<ProfilerSection>(m, "ProfilerSection")
+      .def("__enter__",
+           [](ProfilerSection & self) -> ProfilerSection & {
+             self.scope.emplace(self.section);
+             return self;
+           },
+           py::return_value_policy::reference_internal)
+      .def("__exit__", [](ProfilerSection & self, py::args) { self.scope.reset(); });
+
+  py::class_<Profiler>(m, "Profiler")
+      .def_readwrite("enabled", &Profiler::enabled)
+      .def_property_readonly("sections", &Profiler::sections)
+      .def_property_readonly("frames", &Profiler::frames)
+      .def("section", [](Profiler & self, const std::string & name) { return ProfilerSection{self.section(name), {}}; },
+           "Returns a context manager that times its body as the section name")
+      .def("samples",
+           [](const Profiler & self, const std::string & name) {
+             const auto & names = self.sections();
+             auto it = std::find(names.begin(), names.end(), name);
+             if(it == names.end())
+             {
+               throw py::key_error(fmt::format("No profiler section named {}", name));
+             }
+             auto samples = self.samples(static_cast<size_t>(std::distance(names.begin(), it)));
+             return py::array_t<float>(samples.size(), samples.data());
+           },
+           "Time (ms) spent in a section during the last frames, oldest first")
+      .def("end_frame", &Profiler::end_frame)
+      .def("reset", &Profiler::reset);
+  m.def("profiler", &Profiler::get, py::return_value_policy::reference);
+
+  using mc_rtc::blender::Tracer;
+  py::class_<Tracer>(m, "Tracer")
+      .def_property_readonly("enabled", [](const Tracer &) { return Tracer::enabled(); })
+      .def_property_readonly("events", &Tracer::events)
+      .def_property_readonly("dropped", &Tracer::dropped)
+      .def("start", &Tracer::start, "Forget the recorded events and start recording")
+      .def("stop", &Tracer::stop, "Stop recording, the events are kept until the next start()")
+      .def("dump", &Tracer::dump, py::call_guard<py::gil_scoped_release>(),
+           "Write the recorded events as a Chrome trace (JSON), returns False if it fails");
+  m.def("tracer", &Tracer::get, py::return_value_policy::reference);
+
   py::class_<mc_rtc::blender::BlenderClient>(m, "Client")
       .def(py::init<Interface3D &>())
-      .def("connect", static_cast<void (mc_rtc::blender::BlenderClient::*)(const std::string &, const std::string &)>(
-                          &mc_rtc::blender::BlenderClient::connect))
+      .def("connect", &mc_rtc::blender::BlenderClient::connect_controller, py::arg("sub_uri"), py::arg("push_uri"))
       .def("timeout", static_cast<void (mc_rtc::blender::BlenderClient::*)(double)>(&mc_rtc::blender::BlenderClient::timeout))
       .def("update", &mc_rtc::blender::BlenderClient::update)
       .def("draw2D", &mc_rtc::blender::BlenderClient::draw2D)
-      .def("draw3D", &mc_rtc::blender::BlenderClient::draw3D);
+      .def("draw3D", &mc_rtc::blender::BlenderClient::draw3D)
+      .def("record", &mc_rtc::blender::BlenderClient::record, py::arg("path"))
+      .def_property_readonly("recording", &mc_rtc::blender::BlenderClient::recording)
+      .def("replay", &mc_rtc::blender::BlenderClient::replay, py::arg("path"), py::arg("speed") = 1.0,
+           py::arg("loop") = false)
+      .def_property_readonly("replaying", &mc_rtc::blender::BlenderClient::replaying)
+      .def("handle_message",
+           [](mc_rtc::blender::BlenderClient & self, py::bytes message) {
+             char * data = nullptr;
+             ssize_t size = 0;
+             PYBIND11_BYTES_AS_STRING_AND_SIZE(message.ptr(), &data, &size);
+             self.handle_message(data, static_cast<size_t>(size));
+           })
+      .def_property_readonly("settings", &mc_rtc::blender::BlenderClient::settings,
+                             py::return_value_policy::reference_internal)
+      .def_property(
+          "camera", [](const mc_rtc::blender::BlenderClient & self) -> Eigen::Vector3d { return self.camera(); },
+          [](mc_rtc::blender::BlenderClient & self, const Eigen::Vector3d & position) { self.camera(position); },
+          "Position of the viewport camera, used to pick the level of detail of the widgets")
+      .def_property_readonly("stats", &mc_rtc::blender::BlenderClient::stats,
+                             py::return_value_policy::reference_internal)
+      .def("robots",
+           [](const mc_rtc::blender::BlenderClient & self) {
+             std::vector<std::string> names;
+             for(const auto & r : self.robots())
+             {
+               names.push_back(r.first);
+             }
+             return names;
+           })
+      .def(
+          "robot_body_poses",
+          [](mc_rtc::blender::BlenderClient & self, const std::string & name) {
+            return pose_view(get_robot(self, name).body_poses());
+          },
+          "World pose of every body of a robot as a read-only (N, 7) array of [tx, ty, tz, qw, qx, qy, qz]")
+      .def(
+          "robot_mesh_poses",
+          [](mc_rtc::blender::BlenderClient & self, const std::string & name) {
+            return pose_view(get_robot(self, name).mesh_poses());
+          },
+          "World pose of every visual mesh of a robot as a read-only (N, 7) array of [tx, ty, tz, qw, qx, qy, qz]");
 
   m.attr("INDEX_SIZE") = sizeof(ImDrawIdx);
   m.attr("VERTEX_SIZE") = sizeof(ImDrawVert);
@@ -207,10 +531,24 @@ PYBIND11_MODULE(mc_rtc_blender, m)
              self.GetTexDataAsRGBA32(&pixels, &width, &height);
              return {width, height, py::bytes(reinterpret_cast<char *>(pixels), 4 * width * height)};
            })
+      .def(
+          "get_tex_data_as_alpha8",
+          [](py::object self) -> std::tuple<int, int, py::array> {
+            int width;
+            int height;
+            unsigned char * pixels;
+            self.cast<ImFontAtlas &>().GetTexDataAsAlpha8(&pixels, &width, &height);
+            return {width, height, readonly_view(self, pixels, {height, width})};
+          },
+          "Returns the width, height and a (height, width) view of the texture, valid until clear_tex_data is called")
       .def_property(
           "texture_id", [](ImFontAtlas & self) { return uint64_t(self.TexID); },
           [](ImFontAtlas & self, uint64_t value) { self.TexID = (void *)(value); });
 
+  m.def("build_font_atlas", &mc_rtc::blender::build_font_atlas, py::arg("atlas"), py::arg("size"), py::arg("scale"),
+        py::arg("cache_dir"),
+        "Load the GUI font at size * scale in atlas, returns True if the rasterized font was found in cache_dir");
+
   py::class_<ImGuiIO>(m, "ImGuiIO")
       .def_readwrite("delta_time", &ImGuiIO::DeltaTime)
       .def_property_readonly("key_map",
@@ -268,7 +606,10 @@ PYBIND11_MODULE(mc_rtc_blender, m)
 
   m.def("new_frame", &ImGui::NewFrame);
   m.def("end_frame", &ImGui::EndFrame);
-  m.def("render", &ImGui::Render);
+  m.def("render", []() {
+    MC_RTC_BLENDER_PROFILE("imgui/render");
+    ImGui::Render();
+  });
 
   py::class_<ImDrawCmd>(m, "ImDrawCmd")
       .def_property_readonly("clip_rect",
@@ -285,11 +626,24 @@ PYBIND11_MODULE(mc_rtc_blender, m)
           "__iter__", [](ImVector<ImDrawCmd> & self) { return py::make_iterator(self.begin(), self.end()); },
           py::keep_alive<0, 1>());
 
-  py::class_<ImDrawList>(m, "ImDrawList")
+  // The buffers are exposed without copies, ImGui reuses them so the views are only valid until the next frame is
+  // rendered, the renderer uses DrawDataExport which owns its arrays
+  py::class_<ImDrawList>(m, "ImDrawList",
+                         "Draw list of the current frame, idx_buffer and vtx_pos/vtx_uv/vtx_col are read-only views of "
+                         "ImGui buffers that are only valid until the next frame is rendered, copy them to keep them")
       .def_property_readonly("idx_buffer_size", [](ImDrawList & self) { return self.IdxBuffer.Size; })
-      .def_property_readonly("idx_buffer_data", [](ImDrawList & self) { return std::uintptr_t(self.IdxBuffer.Data); })
+      .def_property_readonly("idx_buffer",
+                             [](py::object self) {
+                               const auto & idx = self.cast<const ImDrawList &>().IdxBuffer;
+                               return readonly_view(self, idx.Data, {idx.Size});
+                             })
       .def_property_readonly("vtx_buffer_size", [](ImDrawList & self) { return self.VtxBuffer.Size; })
-      .def_property_readonly("vtx_buffer_data", [](ImDrawList & self) { return std::uintptr_t(self.VtxBuffer.Data); })
+      .def_property_readonly(
+          "vtx_pos", [](py::object self) { return vertex_view<float>(self, offsetof(ImDrawVert, pos), 2); })
+      .def_property_readonly(
+          "vtx_uv", [](py::object self) { return vertex_view<float>(self, offsetof(ImDrawVert, uv), 2); })
+      .def_property_readonly(
+          "vtx_col", [](py::object self) { return vertex_view<uint8_t>(self, offsetof(ImDrawVert, col), 4); })
       .def_readonly("commands", &ImDrawList::CmdBuffer);
 
   py::class_<ImDrawListProxy>(m, "_ImDrawListProxy")
@@ -298,14 +652,41 @@ PYBIND11_MODULE(mc_rtc_blender, m)
           "__iter__", [](ImDrawListProxy & self) { return py::make_iterator(self.begin(), self.end()); },
           py::keep_alive<0, 1>());
 
+  using mc_rtc::blender::DrawDataExport;
+  auto exportView = [](auto member, py::ssize_t cols) {
+    return [member, cols](py::object self) { return member_view(self, self.cast<DrawDataExport &>().*member, cols); };
+  };
+  py::class_<DrawDataExport>(m, "DrawDataExport", "Flat copy of the draw data, arrays are valid until the next export")
+      .def(py::init<>())
+      .def_property_readonly("positions", exportView(&DrawDataExport::positions, 2))
+      .def_property_readonly("uvs", exportView(&DrawDataExport::uvs, 2))
+      .def_property_readonly("colors", exportView(&DrawDataExport::colors, 4))
+      .def_property_readonly("indices", exportView(&DrawDataExport::indices, 1))
+      .def_property_readonly("lists", exportView(&DrawDataExport::lists, DrawDataExport::LIST_SIZE))
+      .def_property_readonly("commands", exportView(&DrawDataExport::commands, DrawDataExport::COMMAND_SIZE))
+      .def_property_readonly("textures", exportView(&DrawDataExport::textures, 1))
+      .def_property_readonly("clip_rects", exportView(&DrawDataExport::clip_rects, 4))
+      .def_readonly("merged_commands", &DrawDataExport::merged_commands);
+
   py::class_<ImDrawData>(m, "ImDrawData")
       .def("scale_clip_rects",
            [](ImDrawData & self, float x, float y) {
              self.ScaleClipRects({x, y});
            })
+      .def(
+          "export", [](const ImDrawData & self, DrawDataExport & out) { out.update(self); },
+          "Copy the draw data of the frame to out")
       .def_property_readonly("commands_lists", [](ImDrawData & self) { return ImDrawListProxy(self); });
 
   m.def("get_draw_data", &ImGui::GetDrawData, py::return_value_policy::reference);
+  m.def(
+      "draw_data_changed",
+      []() {
+        static mc_rtc::blender::DrawDataFingerprint fingerprint;
+        auto * data = ImGui::GetDrawData();
+        return data == nullptr || fingerprint.changed(*data);
+      },
+      "True if the draw data of the last rendered frame differs from the one of the previous call");
 
   m.def("show_demo_window", []() { ImGui::ShowDemoWindow(); });
   m.def("begin", [](const char * name, bool open) { return ImGui::Begin(name, &open); });
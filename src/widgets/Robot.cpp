@@ -1,17 +1,11 @@
 #include "Robot.h"
 
-#include <boost/filesystem.hpp>
-namespace bfs = boost::filesystem;
+#include "details/RobotModel.h"
 
-#ifdef MC_RTC_HAS_ROS_SUPPORT
-#  include <ros/package.h>
-#endif
+#include <RBDyn/FK.h>
 
-#include <mc_rbdyn/RobotLoader.h>
-#include <mc_rbdyn/Robots.h>
-
-#include <mc_rtc/config.h>
-#include <mc_rtc/version.h>
+#include <algorithm>
+#include <atomic>
 
 namespace mc_rtc::blender
 {
@@ -19,89 +13,47 @@ namespace mc_rtc::blender
 namespace details
 {
 
-template<typename T>
-void setConfiguration(T & robot, const std::vector<std::vector<double>> & q)
+/** Everything needed to draw one visual element of a robot */
+struct DrawRecord
 {
-  static_assert(std::is_same_v<T, mc_rbdyn::Robot>);
-  robot.mbc().q = q;
-}
+  /** Pose of the visual in the body frame */
+  sva::PTransformd origin;
+  /** Index of the body in the robot */
+  unsigned int body;
+  /** Index of the mesh in the DrawList batch, only meaningful for meshes */
+  unsigned int mesh;
+  /** Kind of geometry */
+  rbd::parsers::Geometry::Type kind;
+};
 
-inline bfs::path convertURI(const mc_rbdyn::RobotModule & rm, const std::string & uri)
+/** Draw records of a robot model (visual or collision) and the meshes they refer to */
+struct DrawList
 {
-  const std::string package = "package://";
-  if(uri.size() >= package.size() && uri.find(package) == 0)
-  {
-    size_t split = uri.find('/', package.size());
-    std::string pkg = uri.substr(package.size(), split - package.size());
-    auto leaf = bfs::path(uri.substr(split + 1));
-    bfs::path MC_ENV_DESCRIPTION_PATH(mc_rtc::MC_ENV_DESCRIPTION_PATH);
-#ifndef __EMSCRIPTEN__
-#  ifndef MC_RTC_HAS_ROS_SUPPORT
-    // FIXME Prompt the user for unknown packages
-    if(pkg == "jvrc_description")
-    {
-      pkg = (MC_ENV_DESCRIPTION_PATH / ".." / "jvrc_description").string();
-    }
-    else if(pkg == "mc_env_description")
-    {
-      pkg = MC_ENV_DESCRIPTION_PATH.string();
-    }
-    else if(pkg == "mc_int_obj_description")
-    {
-      pkg = (MC_ENV_DESCRIPTION_PATH / ".." / "mc_int_obj_description").string();
-    }
-    else
-    {
-      mc_rtc::log::warning("Cannot resolve package: {}, assuming it's {}", pkg, rm.path);
-      pkg = rm.path;
-    }
-#  else
-    pkg = ros::package::getPath(pkg);
-#  endif
-#else
-    pkg = "/assets/" + pkg;
-#endif
-    return pkg / leaf;
-  }
-  const std::string file = "file://";
-  if(uri.size() >= file.size() && uri.find(file) == 0)
-  {
-    return bfs::path(uri.substr(file.size()));
-  }
-  return uri;
-}
+  std::vector<DrawRecord> records;
+  MeshBatch batch;
+  /** Owns the meshes in the batch */
+  std::vector<std::unique_ptr<Mesh>> meshes;
 
-mc_rbdyn::RobotModulePtr fromParams(const std::vector<std::string> & p)
-{
-  mc_rbdyn::RobotModulePtr rm{nullptr};
-  if(p.size() == 1)
-  {
-    rm = mc_rbdyn::RobotLoader::get_robot_module(p[0]);
-  }
-  if(p.size() == 2)
-  {
-    rm = mc_rbdyn::RobotLoader::get_robot_module(p[0], p[1]);
-  }
-  if(p.size() == 3)
-  {
-    rm = mc_rbdyn::RobotLoader::get_robot_module(p[0], p[1], p[2]);
-  }
-  if(p.size() > 3)
+  void clear()
   {
-    mc_rtc::log::warning("Too many parameters provided to load the robot, complain to the developpers of this package");
+    records.clear();
+    batch.clear();
+    meshes.clear();
   }
-  return rm;
-}
+};
 
-inline std::array<double, 4> color(const rbd::parsers::Material & m)
+/** Result of a model load running in the background, see RobotModel::get_async
+ *
+ * The thread and the robot share this state, a robot that does not need the result anymore only drops its reference
+ */
+struct LoadState
 {
-  if(m.type == rbd::parsers::Material::Type::COLOR)
-  {
-    const auto & c = boost::get<rbd::parsers::Material::Color>(m.data);
-    return {c.r, c.g, c.b, c.a};
-  }
-  return {0.8, 0.8, 0.8, 1.0};
-}
+  std::shared_ptr<const RobotModel> model;
+  RobotModel::Meshes meshes;
+  std::string error;
+  /** Set by the thread once model or error is available */
+  std::atomic<bool> done{false};
+};
 
 struct RobotImpl
 {
@@ -117,11 +69,9 @@ struct RobotImpl
     }
   }
 
-  ~RobotImpl() {}
-
-  inline mc_rbdyn::Robot & robot()
+  inline const rbd::MultiBody & mb()
   {
-    return robots_->robot();
+    return model_->module->mb;
   }
 
   inline const mc_control::ElementId & id()
@@ -138,161 +88,319 @@ struct RobotImpl
             const std::vector<std::vector<double>> & q,
             const sva::PTransformd & posW)
   {
-    if(!robots_ || robot().module().parameters() != params)
+    if(params != params_)
     {
-      auto rm = fromParams(params);
-      if(!rm)
-      {
-        return;
-      }
-      robots_ = mc_rbdyn::loadRobot(*rm);
-      auto loadMeshCallback = [&](std::vector<std::function<void()>> & draws, Collection & collection, size_t bIdx,
-                                  const rbd::parsers::Visual & visual) {
-        const auto & meshInfo = boost::get<rbd::parsers::Geometry::Mesh>(visual.geometry.data);
-        auto path = convertURI(*rm, meshInfo.filename);
-        auto mesh =
-            std::make_shared<Mesh>(collection, path.string(), robot().mb().body(bIdx).name(), color(visual.material));
-        draws.push_back([this, bIdx, visual, mesh]() {
-          const auto & X_0_b = visual.origin * robot().mbc().bodyPosW[bIdx];
-          mesh->set_position(X_0_b);
-        });
-      };
-      auto loadBoxCallback = [&](std::vector<std::function<void()>> & draws, Collection & collection, size_t bIdx,
-                                 const rbd::parsers::Visual & visual) {
-        draws.push_back([this, bIdx, visual]() {
-          const auto & box = boost::get<rbd::parsers::Geometry::Box>(visual.geometry.data);
-          const auto & X_0_b = visual.origin * robot().mbc().bodyPosW[bIdx];
-          // gui().drawCube(translation(X_0_b), convert(X_0_b.rotation()), translation(box.size),
-          // color(visual.material));
-        });
-      };
-      auto loadCylinderCallback = [&](std::vector<std::function<void()>> & draws, Collection & collection, size_t bIdx,
-                                      const rbd::parsers::Visual & visual) {
-        draws.push_back([this, bIdx, visual]() {
-          const auto & cylinder = boost::get<rbd::parsers::Geometry::Cylinder>(visual.geometry.data);
-          const auto & start = sva::PTransformd(Eigen::Vector3d{0.0, 0.0, -cylinder.length / 2}) * visual.origin
-                               * robot().mbc().bodyPosW[bIdx];
-          const auto & end = sva::PTransformd(Eigen::Vector3d{0.0, 0.0, cylinder.length}) * start;
-          // gui().drawArrow(translation(start), translation(end), 2 * cylinder.radius, 0.0f, 0.0f,
-          //                color(visual.material));
-        });
-      };
-      auto loadSphereCallback = [&](std::vector<std::function<void()>> & draws, Collection & collection, size_t bIdx,
-                                    const rbd::parsers::Visual & visual) {
-        draws.push_back([this, bIdx, visual]() {
-          const auto & sphere = boost::get<rbd::parsers::Geometry::Sphere>(visual.geometry.data);
-          const auto & X_0_b = visual.origin * robot().mbc().bodyPosW[bIdx];
-          // gui().drawSphere(translation(X_0_b), static_cast<float>(sphere.radius), color(visual.material));
-        });
-      };
-      auto loadBodyCallbacks = [&](std::vector<std::function<void()>> & draws, Collection & collection, size_t bIdx,
-                                   const std::vector<rbd::parsers::Visual> & visuals) {
-        for(const auto & visual : visuals)
-        {
-          using Geometry = rbd::parsers::Geometry;
-          switch(visual.geometry.type)
-          {
-            case Geometry::MESH:
-              loadMeshCallback(draws, collection, bIdx, visual);
-              break;
-            case Geometry::BOX:
-              loadBoxCallback(draws, collection, bIdx, visual);
-              break;
-            case Geometry::CYLINDER:
-              loadCylinderCallback(draws, collection, bIdx, visual);
-              break;
-            case Geometry::SPHERE:
-              loadSphereCallback(draws, collection, bIdx, visual);
-              break;
-            default:
-              break;
-          };
-        }
-      };
-      auto loadCallbacks = [&](std::vector<std::function<void()>> & draws, Collection & collection,
-                               const auto & visuals) {
-        draws.clear();
-        const auto & bodies = robot().mb().bodies();
-        for(size_t i = 0; i < bodies.size(); ++i)
-        {
-          const auto & b = bodies[i];
-          if(!visuals.count(b.name()))
-          {
-            continue;
-          }
-          loadBodyCallbacks(draws, collection, i, visuals.at(b.name()));
-        }
-      };
-      loadCallbacks(drawVisual_, collectionVisual_, robot().module()._visual);
-      loadCallbacks(drawCollision_, collectionCollision_, robot().module()._collision);
+      params_ = params;
+      startLoading(false);
     }
-    robot().posW(posW);
-    setConfiguration(robot(), q);
+    // Only the latest configuration is kept, it is applied in draw3D once the robot is ready
+    q_ = q;
+    posW_ = posW;
+    newData_ = true;
   }
 
   void draw2D()
   {
-    if(!robots_)
+    if(!model_)
     {
       return;
     }
     if(ImGui::Button(self_.label(fmt::format("Reload {}", self_.id.name)).c_str()))
     {
-      robots_.reset();
+      startLoading(true);
     }
     if(ImGui::Checkbox(self_.label(fmt::format("Draw {} visual model", self_.id.name)).c_str(), &drawVisualModel_))
     {
       collectionVisual_.hide(!drawVisualModel_);
+      forceUpdate_ = true;
     }
 
     if(ImGui::Checkbox(self_.label(fmt::format("Draw {} collision model", self_.id.name)).c_str(),
                        &drawCollisionModel_))
     {
       collectionCollision_.hide(!drawCollisionModel_);
+      forceUpdate_ = true;
     }
   }
 
   void draw3D()
   {
-    if(!robots_)
+    pollLoading();
+    if(building_)
+    {
+      buildDrawLists();
+    }
+    if(!model_)
     {
       return;
     }
+    if(newData_)
+    {
+      setConfiguration(q_, posW_);
+      newData_ = false;
+    }
+    updateDirtyBodies();
+    // Visual poses are always computed as they are exposed through mesh_poses()
+    draw(drawVisual_);
     if(drawVisualModel_)
     {
-      for(const auto & d : drawVisual_)
+      send(drawVisual_.batch);
+    }
+    else
+    {
+      drawVisual_.batch.discard();
+    }
+    if(drawCollisionModel_)
+    {
+      draw(drawCollision_);
+      send(drawCollision_.batch);
+    }
+    forceUpdate_ = false;
+  }
+
+  std::shared_ptr<const std::vector<float>> body_poses() const
+  {
+    return bodyPoses_;
+  }
+
+  std::shared_ptr<const std::vector<float>> mesh_poses() const
+  {
+    if(!model_)
+    {
+      return nullptr;
+    }
+    return drawVisual_.batch.poses();
+  }
+
+private:
+  /** Start loading the model for the current parameters in the background
+   *
+   * A load that is still running is abandoned and its result will be ignored, it is never waited for
+   */
+  void startLoading(bool reload)
+  {
+    loading_ = std::make_shared<LoadState>();
+    auto done = [state = loading_](std::shared_ptr<const RobotModel> model, RobotModel::Meshes meshes,
+                                   const std::string & error) {
+      state->model = std::move(model);
+      state->meshes = std::move(meshes);
+      state->error = error;
+      state->done.store(true, std::memory_order_release);
+    };
+    RobotModel::get_async(params_, reload, done);
+  }
+
+  /** Check if the model being loaded is ready and start creating its meshes */
+  void pollLoading()
+  {
+    if(!loading_ || !loading_->done.load(std::memory_order_acquire))
+    {
+      return;
+    }
+    auto model = std::move(loading_->model);
+    auto meshes = std::move(loading_->meshes);
+    if(loading_->error.size())
+    {
+      mc_rtc::log::error("Failed to load {}: {}", self_.id.name, loading_->error);
+    }
+    loading_.reset();
+    if(!model)
+    {
+      return;
+    }
+    building_ = std::move(model);
+    buildMeshes_ = std::move(meshes);
+    model_.reset();
+    drawVisual_.clear();
+    drawCollision_.clear();
+    buildIndex_ = 0;
+  }
+
+  /** Create a bounded number of meshes for the model being built, the model is used once all meshes are created */
+  void buildDrawLists()
+  {
+    MC_RTC_BLENDER_TRACE("robot/build_draw_lists");
+    const auto & visual = building_->visual;
+    const auto & collision = building_->collision;
+    size_t budget = std::max<size_t>(self_.blender().settings().meshes_per_frame, 1);
+    size_t created = 0;
+    while(buildIndex_ < visual.size() + collision.size() && created < budget)
+    {
+      bool isVisual = buildIndex_ < visual.size();
+      const auto & rv = isVisual ? visual[buildIndex_] : collision[buildIndex_ - visual.size()];
+      if(isVisual)
+      {
+        addVisual(drawVisual_, collectionVisual_, rv);
+      }
+      else
       {
-        d();
+        addVisual(drawCollision_, collectionCollision_, rv);
       }
+      created += rv.kind == rbd::parsers::Geometry::MESH;
+      buildIndex_++;
     }
-    if(drawCollisionModel_)
+    if(buildIndex_ < visual.size() + collision.size())
     {
-      for(const auto & d : drawCollision_)
+      return;
+    }
+    model_ = std::move(building_);
+    // The interface keeps its own meshes, the decoded data is not needed anymore
+    buildMeshes_.clear();
+    mbc_ = model_->module->mbc;
+    bodyPoses_ = std::make_shared<std::vector<float>>(MeshBatch::POSE_SIZE * mb().nrBodies(), 0.0f);
+    lastPosW_.resize(mb().nrBodies());
+    dirty_.resize(mb().nrBodies());
+    forceUpdate_ = true;
+    // mbc_ is back to the module's default, the latest configuration may not be received again
+    newData_ = true;
+  }
+
+  /** Update the configuration and the bodies' world poses */
+  void setConfiguration(const std::vector<std::vector<double>> & q, const sva::PTransformd & posW)
+  {
+    if(q.size() == mbc_.q.size())
+    {
+      mbc_.q = q;
+    }
+    bool freeBase = mb().joint(0).type() == rbd::Joint::Free;
+    if(freeBase)
+    {
+      const Eigen::Quaterniond rotation{posW.rotation().transpose()};
+      const auto & t = posW.translation();
+      mbc_.q[0] = {rotation.w(), rotation.x(), rotation.y(), rotation.z(), t.x(), t.y(), t.z()};
+    }
+    rbd::forwardKinematics(mb(), mbc_);
+    if(!freeBase)
+    {
+      for(auto & X_0_b : mbc_.bodyPosW)
       {
-        d();
+        X_0_b = X_0_b * posW;
       }
     }
   }
 
-private:
+  /** Decoded data of the mesh at \p path, nullptr if the interface must load it */
+  std::shared_ptr<const MeshData> meshData(const std::string & path) const
+  {
+    auto it = buildMeshes_.find(path);
+    return it != buildMeshes_.end() ? it->second : nullptr;
+  }
+
+  /** Create the mesh and draw record for a visual of the model being built */
+  void addVisual(DrawList & list, Collection & collection, const RobotVisual & visual)
+  {
+    DrawRecord record{visual.origin, visual.body, 0, visual.kind};
+    if(visual.kind == rbd::parsers::Geometry::MESH)
+    {
+      const auto & name = building_->module->mb.body(visual.body).name();
+      auto mesh = std::make_unique<Mesh>(collection, visual.mesh, name, visual.color, meshData(visual.mesh));
+      record.mesh = static_cast<unsigned int>(list.batch.add(*mesh));
+      list.meshes.push_back(std::move(mesh));
+    }
+    list.records.push_back(record);
+  }
+
+  /** Set the pose of the meshes attached to a moving body */
+  void draw(DrawList & list)
+  {
+    const auto & bodyPosW = mbc_.bodyPosW;
+    for(const auto & r : list.records)
+    {
+      if(!dirty_[r.body])
+      {
+        continue;
+      }
+      switch(r.kind)
+      {
+        case rbd::parsers::Geometry::MESH:
+          list.batch.set(r.mesh, r.origin * bodyPosW[r.body]);
+          break;
+        default:
+          /** FIXME Implement primitives (box, cylinder, sphere) */
+          break;
+      }
+    }
+  }
+
+  /** Mark the bodies that moved since their last update and store their new pose */
+  void updateDirtyBodies()
+  {
+    const auto & settings = self_.blender().settings();
+    double cosTolerance = std::cos(settings.rotation_tolerance);
+    const auto & bodyPosW = mbc_.bodyPosW;
+    for(size_t i = 0; i < bodyPosW.size(); ++i)
+    {
+      const auto & X_0_b = bodyPosW[i];
+      auto & last = lastPosW_[i];
+      bool dirty = forceUpdate_ || (X_0_b.translation() - last.translation()).norm() > settings.translation_tolerance
+                   // cos of the rotation angle between the two orientations
+                   || 0.5 * ((X_0_b.rotation() * last.rotation().transpose()).trace() - 1.0) < cosTolerance;
+      dirty_[i] = dirty;
+      if(dirty)
+      {
+        last = X_0_b;
+        MeshBatch::write_pose(X_0_b, &(*bodyPoses_)[MeshBatch::POSE_SIZE * i]);
+      }
+    }
+  }
+
+  void send(MeshBatch & batch)
+  {
+    auto & stats = self_.blender().stats();
+    stats.sent_mesh_updates += batch.pending();
+    stats.skipped_mesh_updates += batch.size() - batch.pending();
+    batch.send(gui());
+  }
+
   Robot & self_;
-  std::shared_ptr<mc_rbdyn::Robots> robots_;
-  bool drawVisualModel_ = true;
-  bool drawCollisionModel_ = false;
-  std::vector<std::function<void()>> drawVisual_;
-  std::vector<std::function<void()>> drawCollision_;
+  /** Collections are declared first as the meshes in the draw lists must be destroyed before them */
   Collection collectionVisual_;
   Collection collectionCollision_;
+  /** Parameters of the robot module */
+  std::vector<std::string> params_;
+  /** Model being loaded in the background, nullptr if there is none */
+  std::shared_ptr<LoadState> loading_;
+  /** Loaded model whose meshes are being created */
+  std::shared_ptr<const RobotModel> building_;
+  /** Next visual of building_ to create, collision visuals come after the visual ones */
+  size_t buildIndex_ = 0;
+  /** Decoded meshes of building_, kept alive until its meshes are created */
+  RobotModel::Meshes buildMeshes_;
+  /** Model currently displayed, nullptr until the robot is ready */
+  std::shared_ptr<const RobotModel> model_;
+  /** Latest configuration received */
+  std::vector<std::vector<double>> q_;
+  sva::PTransformd posW_ = sva::PTransformd::Identity();
+  /** True if q_/posW_ changed since they were last applied */
+  bool newData_ = false;
+  rbd::MultiBodyConfig mbc_;
+  std::shared_ptr<std::vector<float>> bodyPoses_;
+  /** Last pose used to update each body */
+  std::vector<sva::PTransformd> lastPosW_;
+  /** Bodies that moved during the current frame */
+  std::vector<bool> dirty_;
+  /** Update all bodies on the next frame */
+  bool forceUpdate_ = true;
+  bool drawVisualModel_ = true;
+  bool drawCollisionModel_ = false;
+  DrawList drawVisual_;
+  DrawList drawCollision_;
 };
 
 } // namespace details
 
 Robot::Robot(Client & client, const ElementId & id, Interface3D & gui)
-: Widget(client, id, gui), impl_(new details::RobotImpl{*this})
+: Widget(client, id, gui), impl_(new details::RobotImpl{*this}),
+  draw2DSection_(Profiler::get().section("draw2D/robot/" + full_name())),
+  draw3DSection_(Profiler::get().section("draw3D/robot/" + full_name()))
 {
+  blender().robots_[full_name()] = this;
 }
 
-Robot::~Robot() = default;
+Robot::~Robot()
+{
+  blender().robots_.erase(full_name());
+}
 
 void Robot::data(const std::vector<std::string> & params,
                  const std::vector<std::vector<double>> & q,
@@ -303,12 +411,24 @@ void Robot::data(const std::vector<std::string> & params,
 
 void Robot::draw2D()
 {
+  ProfilerScope profile(draw2DSection_);
   impl_->draw2D();
 }
 
 void Robot::draw3D()
 {
+  ProfilerScope profile(draw3DSection_);
   impl_->draw3D();
 }
 
+std::shared_ptr<const std::vector<float>> Robot::body_poses() const
+{
+  return impl_->body_poses();
+}
+
+std::shared_ptr<const std::vector<float>> Robot::mesh_poses() const
+{
+  return impl_->mesh_poses();
+}
+
 } // namespace mc_rtc::blender
@@ -25,8 +25,20 @@ struct Robot : public Widget
 
   void draw3D() override;
 
+  /** World pose of every body in the robot, see MeshBatch for the layout
+   *
+   * Returns nullptr until the robot is loaded
+   */
+  std::shared_ptr<const std::vector<float>> body_poses() const;
+
+  /** World pose of every mesh in the robot visual model, see MeshBatch for the layout */
+  std::shared_ptr<const std::vector<float>> mesh_poses() const;
+
 private:
   std::unique_ptr<details::RobotImpl> impl_;
+  /** Profiler sections of this robot */
+  size_t draw2DSection_;
+  size_t draw3DSection_;
 };
 
 } // namespace mc_rtc::blender
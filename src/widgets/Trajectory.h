@@ -2,65 +2,424 @@
 
 #include "Widget.h"
 
+#include "../ThreadPool.h"
+
+#include "details/RingBuffer.h"
+#include "details/Simplify.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <memory>
+
 namespace mc_rtc::blender
 {
 
 template<typename T>
 struct Trajectory : public Widget
 {
-  Trajectory(Client & client, const ElementId & id, Interface3D & gui) : Widget(client, id, gui) {}
+  Trajectory(Client & client, const ElementId & id, Interface3D & gui)
+  : Widget(client, id, gui), polyline_(gui, id.category, id.name)
+  {
+  }
 
+  /** Add a streamed point
+   *
+   * Points too close to the previous one are skipped. When the buffer is full its older half is decimated, points
+   * older than ClientSettings::trajectory_max_duration are dropped by draw3D().
+   */
   void data(const T & point, const mc_rtc::gui::LineConfig & config)
   {
-    points_.push_back(point);
+    full_ = false;
     config_ = config;
+    const auto & settings = blender().settings();
+    size_t capacity = std::max<size_t>(settings.trajectory_max_points, 2);
+    if(points_.capacity() != capacity)
+    {
+      points_.set_capacity(capacity);
+      reset();
+    }
+    if(points_.size()
+       && !significant(points_.back().point, point, settings.trajectory_min_distance, settings.trajectory_min_angle))
+    {
+      return;
+    }
+    if(points_.full())
+    {
+      compact(settings);
+    }
+    points_.push_back({point, clock::now()});
   }
 
   void data(const std::vector<T> & points, const mc_rtc::gui::LineConfig & config)
   {
-    points_ = points;
+    // Only the new points are sent if the points already sent did not change
+    bool same = points.size() >= sent_;
+    for(size_t i = 0; same && i < sent_; ++i)
+    {
+      same = points_[i].point == points[i];
+    }
+    if(!same)
+    {
+      reset();
+    }
+    if(points_.capacity() < points.size())
+    {
+      points_.set_capacity(points.size());
+    }
+    points_.clear();
+    auto now = clock::now();
+    for(const auto & p : points)
+    {
+      points_.push_back({p, now});
+    }
+    full_ = true;
     config_ = config;
   }
 
   void draw3D() override
   {
-    if(points_.size() < 2)
+    ProfilerScope profile(draw3D_section("trajectory"));
+    const auto & c = config_.color;
+    std::array<double, 4> color{c.r, c.g, c.b, c.a};
+    if(color != color_ || config_.width != width_)
+    {
+      color_ = color;
+      width_ = config_.width;
+      polyline_.style(config_);
+    }
+    const auto & settings = blender().settings();
+    if(!full_)
+    {
+      // Done here as the client skips unchanged points, old points expire even if the trajectory does not move anymore
+      expire(clock::now(), settings.trajectory_max_duration);
+    }
+    if(full_ && settings.trajectory_lod_tolerance > 0
+       && points_.size() >= std::max<size_t>(settings.trajectory_lod_min_points, 3))
+    {
+      draw_simplified(settings.trajectory_lod_tolerance);
+      return;
+    }
+    if(simplified_ || simplifying_.valid())
+    {
+      if(simplifying_.valid())
+      {
+        // The running task keeps its buffers, its result is not used
+        simplifying_ = {};
+        simplification_ = std::make_shared<Simplification>();
+      }
+      simplified_ = false;
+      reset();
+    }
+    if(!reset_ && sent_ == points_.size())
     {
       return;
     }
-    /** FIXME Implement */
-    // auto c = convert(config_.color);
-    // for(size_t i = 0; i < points_.size() - 1; ++i)
-    //{
-    //  const auto & p0 = points_[i];
-    //  const auto & p1 = points_[i + 1];
-    //  client.gui().drawLine(translation(p0), translation(p1), c);
-    //}
-    // if constexpr(std::is_same_v<T, sva::PTransformd>)
-    //{
-    //  if(points_.size() < 10) // For "small" trajectories, display all points
-    //  {
-    //    for(const auto & p : points_)
-    //    {
-    //      client.gui().drawFrame(convert(p));
-    //    }
-    //  }
-    //  else // Otherwise draw the start and end points
-    //  {
-    //    client.gui().drawFrame(convert(points_[0]));
-    //    client.gui().drawFrame(convert(points_.back()));
-    //  }
-    //}
-    // else
-    //{
-    //  client.gui().drawCube(translation(points_[0]), {}, {0.04, 0.04, 0.04}, c);
-    //  client.gui().drawSphere(translation(points_.back()), 0.04, c);
-    //}
+    write_points(sent_, buffer_);
+    if(reset_)
+    {
+      polyline_.set(buffer_);
+      polylineSize_ = 0;
+      reset_ = false;
+    }
+    else
+    {
+      polyline_.append(buffer_);
+    }
+    polylineSize_ += points_.size() - sent_;
+    sent_ = points_.size();
+    draw_glyphs();
   }
 
 private:
-  std::vector<T> points_;
+  using clock = std::chrono::steady_clock;
+
+  struct Sample
+  {
+    T point;
+    /** Reception time */
+    clock::time_point time;
+  };
+
+  details::RingBuffer<Sample> points_;
   mc_rtc::gui::LineConfig config_;
+  Interface3D::Polyline polyline_;
+  /** Number of points of points_ already sent to the polyline */
+  size_t sent_ = 0;
+  /** Number of points in the polyline, more than sent_ when points were decimated after they were sent */
+  size_t polylineSize_ = 0;
+  /** True if the polyline must be replaced rather than extended */
+  bool reset_ = true;
+  /** Style of the polyline */
+  std::array<double, 4> color_ = {-1, -1, -1, -1};
+  double width_ = -1;
+  /** Points sent to the polyline */
+  std::vector<float> buffer_;
+  /** True if the points come from a full update */
+  bool full_ = false;
+  /** True if the polyline holds a simplified trajectory */
+  bool simplified_ = false;
+  /** Level of detail of the simplified trajectory */
+  int lod_ = std::numeric_limits<int>::min();
+  /** Bounds of the simplified trajectory */
+  Eigen::Vector3d boundsMin_ = Eigen::Vector3d::Zero();
+  Eigen::Vector3d boundsMax_ = Eigen::Vector3d::Zero();
+
+  /** Buffers of the simplification, only used by the ThreadPool while simplifying_ is valid */
+  struct Simplification
+  {
+    /** All points of the trajectory */
+    std::vector<float> points;
+    size_t count = 0;
+    float tolerance = 0;
+    /** Points of the simplified trajectory */
+    std::vector<float> result;
+    details::Simplifier simplifier;
+
+    void run()
+    {
+      MC_RTC_BLENDER_TRACE("trajectory/simplify");
+      const auto & kept = simplifier.simplify(points.data(), count, tolerance);
+      result.resize(3 * kept.size());
+      for(size_t i = 0; i < kept.size(); ++i)
+      {
+        std::copy_n(&points[3 * kept[i]], 3, &result[3 * i]);
+      }
+    }
+  };
+  /** Shared with the running task so that it outlives the widget */
+  std::shared_ptr<Simplification> simplification_ = std::make_shared<Simplification>();
+  /** Running simplification */
+  std::future<void> simplifying_;
+
+  static const Eigen::Vector3d & translation(const Eigen::Vector3d & p)
+  {
+    return p;
+  }
+
+  static const Eigen::Vector3d & translation(const sva::PTransformd & p)
+  {
+    return p.translation();
+  }
+
+  /** True if \p next is further than \p distance or rotated more than \p angle from \p prev */
+  static bool significant(const T & prev, const T & next, double distance, double angle)
+  {
+    if((translation(next) - translation(prev)).norm() > distance)
+    {
+      return true;
+    }
+    if constexpr(std::is_same_v<T, sva::PTransformd>)
+    {
+      return Eigen::Quaterniond(prev.rotation()).angularDistance(Eigen::Quaterniond(next.rotation())) > angle;
+    }
+    return false;
+  }
+
+  /** Write the points from \p first in \p out, 3 values per point */
+  void write_points(size_t first, std::vector<float> & out) const
+  {
+    out.resize(3 * (points_.size() - first));
+    for(size_t i = first; i < points_.size(); ++i)
+    {
+      const Eigen::Vector3d & t = translation(points_[i].point);
+      float * o = &out[3 * (i - first)];
+      o[0] = static_cast<float>(t.x());
+      o[1] = static_cast<float>(t.y());
+      o[2] = static_cast<float>(t.z());
+    }
+  }
+
+  /** Send a simplified trajectory
+   *
+   * The tolerance is \p tolerance times the distance between the camera and the trajectory bounds. It is rounded down
+   * to a power of sqrt(2) so that the trajectory is only simplified again when the camera distance changes noticeably.
+   *
+   * The trajectory is simplified on the global ThreadPool, the polyline keeps showing the previous result until the
+   * new one is ready. Changes that happen during a simplification are handled by the next one.
+   */
+  void draw_simplified(double tolerance)
+  {
+    using namespace std::chrono_literals;
+    if(simplifying_.valid() && simplifying_.wait_for(0s) == std::future_status::ready)
+    {
+      simplifying_.get();
+      polyline_.set(simplification_->result);
+      simplified_ = true;
+    }
+    bool changed = reset_ || sent_ != points_.size();
+    if(changed)
+    {
+      boundsMin_ = boundsMax_ = translation(points_[0].point);
+      for(size_t i = 1; i < points_.size(); ++i)
+      {
+        const auto & t = translation(points_[i].point);
+        boundsMin_ = boundsMin_.cwiseMin(t);
+        boundsMax_ = boundsMax_.cwiseMax(t);
+      }
+    }
+    const auto & camera = blender().camera();
+    double distance = (camera - camera.cwiseMax(boundsMin_).cwiseMin(boundsMax_)).norm();
+    double t = tolerance * distance;
+    int lod = t > 0 ? static_cast<int>(std::floor(2 * std::log2(t))) : std::numeric_limits<int>::min();
+    if((!changed && lod == lod_) || simplifying_.valid())
+    {
+      return;
+    }
+    lod_ = lod;
+    auto & job = *simplification_;
+    write_points(0, job.points);
+    job.count = points_.size();
+    job.tolerance = t > 0 ? static_cast<float>(std::exp2(0.5 * lod)) : 0.0f;
+    simplifying_ = ThreadPool::global().submit([job = simplification_]() { job->run(); });
+    reset_ = false;
+    sent_ = points_.size();
+    draw_glyphs();
+  }
+
+  /** Send the whole trajectory on the next draw */
+  void reset()
+  {
+    sent_ = 0;
+    reset_ = true;
+  }
+
+  /** Make room in the full buffer
+   *
+   * The older half of the trajectory is decimated with thresholds twice as large as the settings, then four and eight
+   * times as large, until it frees an eighth of the buffer. If this is not enough, the oldest quarter is dropped.
+   *
+   * The decimated points are close to the ones that are kept so they stay in the polyline, which is only sent again
+   * once these extra points outnumber the capacity of the buffer.
+   */
+  void compact(const ClientSettings & settings)
+  {
+    size_t half = points_.size() / 2;
+    size_t target = std::max<size_t>(points_.capacity() / 8, 1);
+    double distance = settings.trajectory_min_distance;
+    double angle = settings.trajectory_min_angle;
+    size_t kept = half;
+    for(size_t level = 0; level < 3 && half - kept < target; ++level)
+    {
+      distance *= 2;
+      angle *= 2;
+      kept = decimate(half, distance, angle, false);
+    }
+    if(half - kept < target)
+    {
+      points_.pop_front(std::max<size_t>(points_.capacity() / 4, 1));
+      reset();
+      return;
+    }
+    decimate(half, distance, angle, true);
+    if(reset_ || sent_ < half)
+    {
+      reset();
+      return;
+    }
+    sent_ -= half - kept;
+    if(polylineSize_ - sent_ > points_.capacity())
+    {
+      reset();
+    }
+  }
+
+  /** Decimate the \p count oldest points with thresholds \p distance and \p angle
+   *
+   * \param apply If false, only count the points that would be kept
+   *
+   * \returns The number of points kept among the \p count oldest ones
+   */
+  size_t decimate(size_t count, double distance, double angle, bool apply)
+  {
+    size_t last = 0;
+    size_t kept = 1;
+    for(size_t i = 1; i < count; ++i)
+    {
+      if(significant(points_[last].point, points_[i].point, distance, angle))
+      {
+        last = apply ? kept : i;
+        if(apply)
+        {
+          points_[kept] = points_[i];
+        }
+        kept++;
+      }
+    }
+    if(apply)
+    {
+      for(size_t i = count; i < points_.size(); ++i)
+      {
+        points_[kept + i - count] = points_[i];
+      }
+      points_.pop_back(count - kept);
+    }
+    return kept;
+  }
+
+  /** Drop the points older than \p duration
+   *
+   * Points are dropped in chunks of a quarter of \p duration so that the polyline is not rebuilt for every new point
+   */
+  void expire(clock::time_point now, double duration)
+  {
+    if(duration <= 0 || points_.empty())
+    {
+      return;
+    }
+    auto limit = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(duration));
+    if(now - points_.front().time < limit + limit / 4)
+    {
+      return;
+    }
+    size_t n = 0;
+    while(n < points_.size() && now - points_[n].time > limit)
+    {
+      n++;
+    }
+    points_.pop_front(n);
+    reset();
+  }
+
+  /** Draw the start and end of the trajectory, every frame is drawn for small PTransformd trajectories */
+  void draw_glyphs()
+  {
+    if(points_.empty())
+    {
+      polyline_.frames({});
+      polyline_.markers(Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero(), 0.0);
+      return;
+    }
+    const T & front = points_.front().point;
+    const T & back = points_.back().point;
+    if constexpr(std::is_same_v<T, sva::PTransformd>)
+    {
+      std::vector<float> poses;
+      auto add = [&](const sva::PTransformd & pose) {
+        poses.resize(poses.size() + MeshBatch::POSE_SIZE);
+        MeshBatch::write_pose(pose, &poses[poses.size() - MeshBatch::POSE_SIZE]);
+      };
+      if(points_.size() < 10)
+      {
+        for(size_t i = 0; i < points_.size(); ++i)
+        {
+          add(points_[i].point);
+        }
+      }
+      else
+      {
+        add(front);
+        add(back);
+      }
+      polyline_.frames(poses);
+    }
+    else
+    {
+      polyline_.markers(front, back, points_.size() < 2 ? 0.0 : 0.04);
+    }
+  }
 };
 
 } // namespace mc_rtc::blender
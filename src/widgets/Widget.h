@@ -3,12 +3,16 @@
 /** Helper header to have all the stuff available in widgets */
 
 #include "../BlenderClient.h"
+#include "../Profiler.h"
 #include "../mc_rtc-imgui/Widget.h"
 
 #include "utils.h"
 
 #include "imgui.h"
 
+#include <limits>
+#include <string>
+
 namespace mc_rtc::blender
 {
 
@@ -21,8 +25,68 @@ struct Widget : public mc_rtc::imgui::Widget
     return gui_;
   }
 
+  /** The client that owns this widget */
+  inline BlenderClient & blender() noexcept
+  {
+    return static_cast<BlenderClient &>(client);
+  }
+
+  /** Returns true if \p fingerprint differs from the one given in the previous call
+   *
+   * This is used to skip the updates that are identical to the previous one
+   */
+  inline bool changed(uint64_t fingerprint) noexcept
+  {
+    bool out = !fingerprinted_ || fingerprint != fingerprint_;
+    fingerprint_ = fingerprint;
+    fingerprinted_ = true;
+    return out;
+  }
+
+  /** Category and name of the widget joined by / */
+  inline std::string full_name() const
+  {
+    std::string out;
+    for(const auto & c : id.category)
+    {
+      out += c + "/";
+    }
+    return out + id.name;
+  }
+
+  /** Profiler section timing the updates of this widget, named data/\p kind/full_name()
+   *
+   * The section is created on the first call, \p kind must be the same in every call
+   */
+  inline size_t data_section(const char * kind)
+  {
+    return section(dataSection_, "data/", kind);
+  }
+
+  /** Profiler section timing draw3D() for this widget, named draw3D/\p kind/full_name(), see data_section() */
+  inline size_t draw3D_section(const char * kind)
+  {
+    return section(draw3DSection_, "draw3D/", kind);
+  }
+
 protected:
   Interface3D & gui_;
+
+private:
+  uint64_t fingerprint_ = 0;
+  bool fingerprinted_ = false;
+  static constexpr size_t NO_SECTION = std::numeric_limits<size_t>::max();
+  size_t dataSection_ = NO_SECTION;
+  size_t draw3DSection_ = NO_SECTION;
+
+  inline size_t section(size_t & section, const char * prefix, const char * kind)
+  {
+    if(section == NO_SECTION)
+    {
+      section = Profiler::get().section(prefix + (kind + ("/" + full_name())));
+    }
+    return section;
+  }
 };
 
 } // namespace mc_rtc::blender
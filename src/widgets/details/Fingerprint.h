@@ -0,0 +1,110 @@
+#pragma once
+
+#include "../../Hash.h"
+
+#include <SpaceVecAlg/SpaceVecAlg>
+
+#include <mc_rtc/gui/types.h>
+
+#include <string>
+#include <vector>
+
+namespace mc_rtc::blender::details
+{
+
+/** Hashing of the payloads received by the widgets, see fingerprint() */
+
+inline uint64_t hash(uint64_t h, bool value) noexcept
+{
+  return Hash::combine(h, value ? 1 : 0);
+}
+
+inline uint64_t hash(uint64_t h, double value) noexcept
+{
+  return Hash::bytes(h, &value, sizeof(double));
+}
+
+inline uint64_t hash(uint64_t h, const std::string & value) noexcept
+{
+  return Hash::combine(Hash::bytes(h, value.data(), value.size()), value.size());
+}
+
+inline uint64_t hash(uint64_t h, const Eigen::Vector3d & value) noexcept
+{
+  return Hash::bytes(h, value.data(), 3 * sizeof(double));
+}
+
+inline uint64_t hash(uint64_t h, const sva::PTransformd & value) noexcept
+{
+  h = Hash::bytes(h, value.rotation().data(), 9 * sizeof(double));
+  return Hash::bytes(h, value.translation().data(), 3 * sizeof(double));
+}
+
+inline uint64_t hash(uint64_t h, const sva::ForceVecd & value) noexcept
+{
+  return hash(hash(h, value.couple()), value.force());
+}
+
+inline uint64_t hash(uint64_t h, const mc_rtc::gui::Color & value) noexcept
+{
+  h = hash(hash(h, value.r), value.g);
+  return hash(hash(h, value.b), value.a);
+}
+
+inline uint64_t hash(uint64_t h, const mc_rtc::gui::LineConfig & value) noexcept
+{
+  h = hash(hash(h, value.color), value.width);
+  return Hash::combine(h, static_cast<uint64_t>(value.style));
+}
+
+inline uint64_t hash(uint64_t h, const mc_rtc::gui::PointConfig & value) noexcept
+{
+  return hash(hash(h, value.color), value.scale);
+}
+
+inline uint64_t hash(uint64_t h, const mc_rtc::gui::ArrowConfig & value) noexcept
+{
+  h = hash(hash(h, value.color), value.shaft_diam);
+  h = hash(hash(h, value.head_diam), value.head_len);
+  h = hash(hash(h, value.scale), value.start_point_scale);
+  return hash(h, value.end_point_scale);
+}
+
+inline uint64_t hash(uint64_t h, const mc_rtc::gui::ForceConfig & value) noexcept
+{
+  return hash(hash(h, static_cast<const mc_rtc::gui::ArrowConfig &>(value)), value.force_scale);
+}
+
+template<typename T>
+uint64_t hash(uint64_t h, const std::vector<T> & value) noexcept
+{
+  if constexpr(std::is_same_v<T, double>)
+  {
+    h = Hash::bytes(h, value.data(), value.size() * sizeof(double));
+  }
+  else if constexpr(std::is_same_v<T, Eigen::Vector3d>)
+  {
+    // Eigen::Vector3d is packed, this hashes the whole vector at once
+    static_assert(sizeof(Eigen::Vector3d) == 3 * sizeof(double));
+    h = Hash::bytes(h, value.data(), value.size() * sizeof(Eigen::Vector3d));
+  }
+  else
+  {
+    for(const auto & v : value)
+    {
+      h = hash(h, v);
+    }
+  }
+  return Hash::combine(h, value.size());
+}
+
+/** Fingerprint of the payload of a widget update, used to detect updates identical to the previous one */
+template<typename... Args>
+uint64_t fingerprint(const Args &... args) noexcept
+{
+  uint64_t h = Hash::SEED;
+  ((h = hash(h, args)), ...);
+  return h;
+}
+
+} // namespace mc_rtc::blender::details
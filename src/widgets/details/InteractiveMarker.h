@@ -11,14 +11,16 @@ template<ControlAxis ctl>
 struct InteractiveMarker
 {
   template<typename Callback>
-  InteractiveMarker(Client & client, const ElementId & id, Interface3D & gui, Callback && cb) : client_(client), gui_(gui)
+  InteractiveMarker(Client & client, const ElementId & id, Interface3D & gui, Callback && cb)
+  : client_(client), gui_(gui), marker_(gui_.acquire_handle())
   {
-    marker_ = gui_.add_interactive_marker(id.category, id.name, ctl, cb);
+    gui_.add_interactive_marker(marker_, id.category, id.name, ctl, cb);
   }
 
   ~InteractiveMarker()
   {
     gui_.remove_interactive_marker(marker_);
+    gui_.release_handle(marker_);
   }
 
   void update(bool ro, const sva::PTransformd & pos)
@@ -34,7 +36,7 @@ struct InteractiveMarker
 private:
   Client & client_;
   Interface3D & gui_;
-  std::string marker_;
+  Interface3D::Handle marker_;
 };
 
 } // namespace mc_rtc::blender
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace mc_rtc::blender::details
+{
+
+/** A queue with a fixed capacity, the storage is allocated once and elements are never moved */
+template<typename T>
+struct RingBuffer
+{
+  RingBuffer(size_t capacity = 0) : data_(capacity) {}
+
+  inline size_t capacity() const noexcept
+  {
+    return data_.size();
+  }
+
+  inline size_t size() const noexcept
+  {
+    return size_;
+  }
+
+  inline bool empty() const noexcept
+  {
+    return size_ == 0;
+  }
+
+  inline bool full() const noexcept
+  {
+    return size_ == data_.size();
+  }
+
+  /** Change the capacity, the newest elements are kept */
+  void set_capacity(size_t capacity)
+  {
+    std::vector<T> data(capacity);
+    size_t keep = std::min(size_, capacity);
+    for(size_t i = 0; i < keep; ++i)
+    {
+      data[i] = (*this)[size_ - keep + i];
+    }
+    data_ = std::move(data);
+    head_ = 0;
+    size_ = keep;
+  }
+
+  /** Add an element at the end, the oldest element is overwritten if the buffer is full */
+  void push_back(const T & value)
+  {
+    if(data_.empty())
+    {
+      return;
+    }
+    if(full())
+    {
+      pop_front();
+    }
+    data_[(head_ + size_) % data_.size()] = value;
+    size_++;
+  }
+
+  /** Remove the \p n oldest elements */
+  void pop_front(size_t n = 1)
+  {
+    n = std::min(n, size_);
+    if(n)
+    {
+      head_ = (head_ + n) % data_.size();
+      size_ -= n;
+    }
+  }
+
+  /** Remove the \p n newest elements */
+  void pop_back(size_t n = 1)
+  {
+    size_ -= std::min(n, size_);
+  }
+
+  void clear()
+  {
+    head_ = 0;
+    size_ = 0;
+  }
+
+  /** Access the \p i-th oldest element */
+  inline T & operator[](size_t i) noexcept
+  {
+    return data_[(head_ + i) % data_.size()];
+  }
+
+  inline const T & operator[](size_t i) const noexcept
+  {
+    return data_[(head_ + i) % data_.size()];
+  }
+
+  inline T & front() noexcept
+  {
+    return (*this)[0];
+  }
+
+  inline const T & front() const noexcept
+  {
+    return (*this)[0];
+  }
+
+  inline T & back() noexcept
+  {
+    return (*this)[size_ - 1];
+  }
+
+  inline const T & back() const noexcept
+  {
+    return (*this)[size_ - 1];
+  }
+
+private:
+  std::vector<T> data_;
+  /** Index of the oldest element in data_ */
+  size_t head_ = 0;
+  size_t size_ = 0;
+};
+
+} // namespace mc_rtc::blender::details
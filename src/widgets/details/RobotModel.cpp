@@ -0,0 +1,411 @@
+#include "RobotModel.h"
+
+#include "../../ThreadPool.h"
+#include "../../Tracer.h"
+
+#include <boost/filesystem.hpp>
+namespace bfs = boost::filesystem;
+
+#ifdef MC_RTC_HAS_ROS_SUPPORT
+#  include <ros/package.h>
+#endif
+
+#include <mc_rbdyn/RobotLoader.h>
+
+#include <mc_rtc/config.h>
+#include <mc_rtc/logging.h>
+#include <mc_rtc/version.h>
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace mc_rtc::blender::details
+{
+
+namespace
+{
+
+bfs::path convertURI(const mc_rbdyn::RobotModule & rm, const std::string & uri)
+{
+  const std::string package = "package://";
+  if(uri.size() >= package.size() && uri.find(package) == 0)
+  {
+    size_t split = uri.find('/', package.size());
+    std::string pkg = uri.substr(package.size(), split - package.size());
+    auto leaf = bfs::path(uri.substr(split + 1));
+    bfs::path MC_ENV_DESCRIPTION_PATH(mc_rtc::MC_ENV_DESCRIPTION_PATH);
+#ifndef __EMSCRIPTEN__
+#  ifndef MC_RTC_HAS_ROS_SUPPORT
+    // FIXME Prompt the user for unknown packages
+    if(pkg == "jvrc_description")
+    {
+      pkg = (MC_ENV_DESCRIPTION_PATH / ".." / "jvrc_description").string();
+    }
+    else if(pkg == "mc_env_description")
+    {
+      pkg = MC_ENV_DESCRIPTION_PATH.string();
+    }
+    else if(pkg == "mc_int_obj_description")
+    {
+      pkg = (MC_ENV_DESCRIPTION_PATH / ".." / "mc_int_obj_description").string();
+    }
+    else
+    {
+      mc_rtc::log::warning("Cannot resolve package: {}, assuming it's {}", pkg, rm.path);
+      pkg = rm.path;
+    }
+#  else
+    pkg = ros::package::getPath(pkg);
+#  endif
+#else
+    pkg = "/assets/" + pkg;
+#endif
+    return pkg / leaf;
+  }
+  const std::string file = "file://";
+  if(uri.size() >= file.size() && uri.find(file) == 0)
+  {
+    return bfs::path(uri.substr(file.size()));
+  }
+  return uri;
+}
+
+mc_rbdyn::RobotModulePtr fromParams(const std::vector<std::string> & p)
+{
+  mc_rbdyn::RobotModulePtr rm{nullptr};
+  if(p.size() == 1)
+  {
+    rm = mc_rbdyn::RobotLoader::get_robot_module(p[0]);
+  }
+  if(p.size() == 2)
+  {
+    rm = mc_rbdyn::RobotLoader::get_robot_module(p[0], p[1]);
+  }
+  if(p.size() == 3)
+  {
+    rm = mc_rbdyn::RobotLoader::get_robot_module(p[0], p[1], p[2]);
+  }
+  if(p.size() > 3)
+  {
+    mc_rtc::log::warning("Too many parameters provided to load the robot, complain to the developpers of this package");
+  }
+  return rm;
+}
+
+std::array<double, 4> color(const rbd::parsers::Material & m)
+{
+  if(m.type == rbd::parsers::Material::Type::COLOR)
+  {
+    const auto & c = boost::get<rbd::parsers::Material::Color>(m.data);
+    return {c.r, c.g, c.b, c.a};
+  }
+  return {0.8, 0.8, 0.8, 1.0};
+}
+
+std::vector<RobotVisual> loadVisuals(const mc_rbdyn::RobotModule & rm,
+                                     const std::map<std::string, std::vector<rbd::parsers::Visual>> & visuals)
+{
+  using Geometry = rbd::parsers::Geometry;
+  std::vector<RobotVisual> out;
+  const auto & bodies = rm.mb.bodies();
+  for(size_t i = 0; i < bodies.size(); ++i)
+  {
+    const auto & b = bodies[i];
+    if(!visuals.count(b.name()))
+    {
+      continue;
+    }
+    for(const auto & visual : visuals.at(b.name()))
+    {
+      RobotVisual rv{visual.origin, static_cast<unsigned int>(i), visual.geometry.type, "", color(visual.material)};
+      switch(visual.geometry.type)
+      {
+        case Geometry::MESH:
+          rv.mesh = convertURI(rm, boost::get<Geometry::Mesh>(visual.geometry.data).filename).string();
+          break;
+        case Geometry::BOX:
+        case Geometry::CYLINDER:
+        case Geometry::SPHERE:
+          break;
+        default:
+          continue;
+      };
+      out.push_back(rv);
+    }
+  }
+  return out;
+}
+
+/** Decode \p path, nullptr if the file cannot be decoded */
+std::shared_ptr<const MeshData> decodeMesh(const std::string & path)
+{
+  MC_RTC_BLENDER_TRACE("robot/decode_mesh");
+  try
+  {
+    return MeshData::load(path);
+  }
+  catch(const std::exception & exc)
+  {
+    // The interface falls back to its own loader
+    mc_rtc::log::warning("{}, the mesh is loaded by the interface", exc.what());
+    return nullptr;
+  }
+}
+
+/** Models shared by the robots, see RobotModel::get */
+struct ModelCache
+{
+  using Future = std::shared_future<std::shared_ptr<const RobotModel>>;
+  struct Entry
+  {
+    /** Model loaded for these parameters */
+    std::weak_ptr<const RobotModel> model;
+    /** Load in progress for these parameters, invalid if there is none */
+    Future pending;
+    /** Identifies the latest load of these parameters */
+    uint64_t generation = 0;
+  };
+  std::mutex mutex;
+  std::map<std::vector<std::string>, Entry> entries;
+
+  static ModelCache & get()
+  {
+    static ModelCache cache;
+    return cache;
+  }
+};
+
+/** Threads started by RobotModel::get_async
+ *
+ * The threads still running when the module is unloaded are joined. The statics they use are created before this
+ * one so they are destroyed after it.
+ */
+struct Loaders
+{
+  Loaders()
+  {
+    ModelCache::get();
+    ThreadPool::global();
+  }
+
+  ~Loaders()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(auto & l : loaders_)
+    {
+      l.thread.join();
+    }
+  }
+
+  /** Run \p f in a new thread, the threads that finished are joined first */
+  void start(std::function<void()> f)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto finished = [](Loader & l) {
+      if(!l.done->load(std::memory_order_acquire))
+      {
+        return false;
+      }
+      l.thread.join();
+      return true;
+    };
+    loaders_.erase(std::remove_if(loaders_.begin(), loaders_.end(), finished), loaders_.end());
+    auto done = std::make_shared<std::atomic<bool>>(false);
+    loaders_.push_back({std::thread([f = std::move(f), done]() {
+                          f();
+                          done->store(true, std::memory_order_release);
+                        }),
+                        done});
+  }
+
+  static Loaders & get()
+  {
+    static Loaders loaders;
+    return loaders;
+  }
+
+private:
+  struct Loader
+  {
+    std::thread thread;
+    std::shared_ptr<std::atomic<bool>> done;
+  };
+  std::mutex mutex_;
+  std::vector<Loader> loaders_;
+};
+
+std::shared_ptr<const RobotModel> load(const std::vector<std::string> & params)
+{
+  MC_RTC_BLENDER_TRACE("robot/load");
+  auto rm = fromParams(params);
+  if(!rm)
+  {
+    return nullptr;
+  }
+  auto model = std::make_shared<RobotModel>();
+  model->params = params;
+  model->module = rm;
+  model->visual = loadVisuals(*rm, rm->_visual);
+  model->collision = loadVisuals(*rm, rm->_collision);
+  return model;
+}
+
+} // namespace
+
+void RobotModel::get_async(const std::vector<std::string> & params, bool reload, Callback callback)
+{
+  // The load waits for mesh decoding tasks on the global ThreadPool so it cannot run there itself
+  Loaders::get().start([params, reload, callback = std::move(callback)]() {
+    std::shared_ptr<const RobotModel> model;
+    Meshes meshes;
+    std::string error;
+    try
+    {
+      model = get(params, reload);
+      if(model)
+      {
+        meshes = model->acquire_meshes();
+      }
+    }
+    catch(const std::exception & exc)
+    {
+      error = exc.what();
+    }
+    callback(std::move(model), std::move(meshes), error);
+  });
+}
+
+RobotModel::Meshes RobotModel::acquire_meshes() const
+{
+  Meshes out;
+  std::map<std::string, std::shared_future<std::shared_ptr<const MeshData>>> pending;
+  // Meshes decoded by this call, the others are decoded by other users
+  std::set<std::string> decoding;
+  {
+    std::lock_guard<std::mutex> lock(meshesMutex_);
+    for(const auto * visuals : {&visual, &collision})
+    {
+      for(const auto & v : *visuals)
+      {
+        if(v.kind != rbd::parsers::Geometry::MESH || out.count(v.mesh) || pending.count(v.mesh))
+        {
+          continue;
+        }
+        auto & mesh = meshes_[v.mesh];
+        if(auto data = mesh.data.lock())
+        {
+          out[v.mesh] = data;
+        }
+        else if(!mesh.failed)
+        {
+          // Another user may already be decoding this mesh
+          if(!mesh.pending.valid())
+          {
+            mesh.pending = ThreadPool::global().submit([path = v.mesh]() { return decodeMesh(path); }).share();
+            decoding.insert(v.mesh);
+          }
+          pending[v.mesh] = mesh.pending;
+        }
+      }
+    }
+  }
+  for(auto & p : pending)
+  {
+    out[p.first] = p.second.get();
+  }
+  {
+    std::lock_guard<std::mutex> lock(meshesMutex_);
+    for(const auto & path : decoding)
+    {
+      auto & mesh = meshes_[path];
+      mesh.data = out[path];
+      mesh.failed = !out[path];
+      mesh.pending = {};
+    }
+  }
+  for(const auto & p : pending)
+  {
+    if(!out[p.first])
+    {
+      out.erase(p.first);
+    }
+  }
+  return out;
+}
+
+std::shared_ptr<const RobotModel> RobotModel::get(const std::vector<std::string> & params, bool reload)
+{
+  auto & mutex = ModelCache::get().mutex;
+  auto & cache = ModelCache::get().entries;
+  // The lock only protects the cache, the models are loaded without holding it so different robots load in parallel
+  std::promise<std::shared_ptr<const RobotModel>> promise;
+  uint64_t generation = 0;
+  ModelCache::Future pending;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for(auto it = cache.begin(); it != cache.end();)
+    {
+      if(it->second.model.expired() && !it->second.pending.valid())
+      {
+        it = cache.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+    auto & entry = cache[params];
+    if(!reload)
+    {
+      if(auto model = entry.model.lock())
+      {
+        return model;
+      }
+      pending = entry.pending;
+    }
+    if(!pending.valid())
+    {
+      entry.pending = promise.get_future().share();
+      generation = ++entry.generation;
+    }
+  }
+  if(pending.valid())
+  {
+    // Share the load of the same parameters that is already in progress
+    return pending.get();
+  }
+  std::shared_ptr<const RobotModel> model;
+  try
+  {
+    model = load(params);
+  }
+  catch(...)
+  {
+    promise.set_exception(std::current_exception());
+    std::lock_guard<std::mutex> lock(mutex);
+    auto & entry = cache[params];
+    if(entry.generation == generation)
+    {
+      entry.pending = {};
+    }
+    throw;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto & entry = cache[params];
+    if(entry.generation == generation)
+    {
+      entry.model = model;
+      entry.pending = {};
+    }
+  }
+  promise.set_value(model);
+  return model;
+}
+
+} // namespace mc_rtc::blender::details
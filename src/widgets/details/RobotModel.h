@@ -0,0 +1,98 @@
+#pragma once
+
+#include "../../MeshLoader.h"
+
+#include <mc_rbdyn/RobotModule.h>
+
+#include <array>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mc_rtc::blender::details
+{
+
+/** A visual element of a robot model */
+struct RobotVisual
+{
+  /** Pose of the visual in the body frame */
+  sva::PTransformd origin;
+  /** Index of the body in the robot */
+  unsigned int body;
+  /** Kind of geometry */
+  rbd::parsers::Geometry::Type kind;
+  /** Resolved path to the mesh file, only meaningful for meshes */
+  std::string mesh;
+  /** Default color of the visual */
+  std::array<double, 4> color;
+};
+
+/** Data shared by every robot displayed with the same parameters */
+struct RobotModel
+{
+  /** Parameters used to load the model */
+  std::vector<std::string> params;
+  /** Loaded module */
+  mc_rbdyn::RobotModulePtr module;
+  /** Visual model */
+  std::vector<RobotVisual> visual;
+  /** Collision model */
+  std::vector<RobotVisual> collision;
+
+  /** Decoded meshes indexed by the path of their file */
+  using Meshes = std::map<std::string, std::shared_ptr<const MeshData>>;
+
+  /** Decode the meshes used by the model, the decoded data is shared with the other users of the model
+   *
+   * The model only keeps weak references to the decoded data: users hold the returned meshes until the interface has
+   * created its own meshes, the data is released after that while the model can remain cached. Meshes that were
+   * released are decoded again in parallel on the global ThreadPool, this blocks so it must not run on the main thread
+   * or on the pool.
+   *
+   * A mesh that cannot be decoded is missing from the result, the interface falls back to its own loader.
+   */
+  Meshes acquire_meshes() const;
+
+  /** Get the model for the given parameters
+   *
+   * Models are shared by every user of the same parameters and released once the last user releases them
+   *
+   * The meshes are not decoded, see acquire_meshes()
+   *
+   * \param params Parameters of the robot module
+   *
+   * \param reload If true, load the model again even if it is already available
+   *
+   * \returns nullptr if the model cannot be loaded
+   */
+  static std::shared_ptr<const RobotModel> get(const std::vector<std::string> & params, bool reload = false);
+
+  /** Called with the loaded model and its meshes, or nullptr and an error message if the model cannot be loaded */
+  using Callback =
+      std::function<void(std::shared_ptr<const RobotModel> model, Meshes meshes, const std::string & error)>;
+
+  /** Call get() then acquire_meshes() in a background thread, then \p callback in the same thread
+   *
+   * The caller never waits for the thread, the threads that are still running when the module is unloaded are joined
+   */
+  static void get_async(const std::vector<std::string> & params, bool reload, Callback callback);
+
+private:
+  struct DecodedMesh
+  {
+    std::weak_ptr<const MeshData> data;
+    /** Decoding in progress, invalid if there is none */
+    std::shared_future<std::shared_ptr<const MeshData>> pending;
+    /** True if the file cannot be decoded, it is not decoded again */
+    bool failed = false;
+  };
+  /** Meshes used by the model indexed by the path of their file, protected by meshesMutex_ */
+  mutable std::map<std::string, DecodedMesh> meshes_;
+  mutable std::mutex meshesMutex_;
+};
+
+} // namespace mc_rtc::blender::details
@@ -0,0 +1,85 @@
+#include "Simplify.h"
+
+#include <algorithm>
+
+namespace mc_rtc::blender::details
+{
+
+namespace
+{
+
+/** Squared distance between \p p and the segment [\p a, \p b] */
+inline float distanceSq(const float * p, const float * a, const float * b) noexcept
+{
+  float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+  float ap[3] = {p[0] - a[0], p[1] - a[1], p[2] - a[2]};
+  float lengthSq = ab[0] * ab[0] + ab[1] * ab[1] + ab[2] * ab[2];
+  float t = 0.0f;
+  if(lengthSq > 0.0f)
+  {
+    t = std::clamp((ap[0] * ab[0] + ap[1] * ab[1] + ap[2] * ab[2]) / lengthSq, 0.0f, 1.0f);
+  }
+  float d[3] = {ap[0] - t * ab[0], ap[1] - t * ab[1], ap[2] - t * ab[2]};
+  return d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+}
+
+} // namespace
+
+const std::vector<uint32_t> & Simplifier::simplify(const float * points, size_t count, float tolerance)
+{
+  kept_.clear();
+  if(count < 3 || tolerance <= 0.0f)
+  {
+    for(size_t i = 0; i < count; ++i)
+    {
+      kept_.push_back(static_cast<uint32_t>(i));
+    }
+    return kept_;
+  }
+  float toleranceSq = tolerance * tolerance;
+  keep_.assign(count, 0);
+  keep_[0] = 1;
+  keep_[count - 1] = 1;
+  stack_.clear();
+  stack_.emplace_back(0, static_cast<uint32_t>(count - 1));
+  while(stack_.size())
+  {
+    auto [first, last] = stack_.back();
+    stack_.pop_back();
+    const float * a = &points[3 * first];
+    const float * b = &points[3 * last];
+    float maxSq = toleranceSq;
+    uint32_t farthest = first;
+    for(uint32_t i = first + 1; i < last; ++i)
+    {
+      float dSq = distanceSq(&points[3 * i], a, b);
+      if(dSq > maxSq)
+      {
+        maxSq = dSq;
+        farthest = i;
+      }
+    }
+    if(farthest != first)
+    {
+      keep_[farthest] = 1;
+      if(farthest - first > 1)
+      {
+        stack_.emplace_back(first, farthest);
+      }
+      if(last - farthest > 1)
+      {
+        stack_.emplace_back(farthest, last);
+      }
+    }
+  }
+  for(size_t i = 0; i < count; ++i)
+  {
+    if(keep_[i])
+    {
+      kept_.push_back(static_cast<uint32_t>(i));
+    }
+  }
+  return kept_;
+}
+
+} // namespace mc_rtc::blender::details
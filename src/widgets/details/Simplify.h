@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace mc_rtc::blender::details
+{
+
+/** Simplify polylines with the Ramer-Douglas-Peucker algorithm
+ *
+ * The recursion is replaced by an explicit stack and the buffers are kept between calls so that simplifying a
+ * polyline of the same size again does not allocate.
+ */
+struct Simplifier
+{
+  /** Select the points of a polyline that are kept so that no point is further than \p tolerance from the result
+   *
+   * \param points Positions of the points, 3 values per point
+   *
+   * \param count Number of points
+   *
+   * \param tolerance Maximum distance between a removed point and the simplified polyline
+   *
+   * \returns Indices of the kept points in increasing order, the first and last points are always kept
+   */
+  const std::vector<uint32_t> & simplify(const float * points, size_t count, float tolerance);
+
+private:
+  std::vector<uint32_t> kept_;
+  std::vector<uint8_t> keep_;
+  std::vector<std::pair<uint32_t, uint32_t>> stack_;
+};
+
+} // namespace mc_rtc::blender::details